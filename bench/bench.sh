@@ -0,0 +1,159 @@
+#!/bin/sh
+#
+# Performance regression suite for gather-bench.
+#
+# Runs the benchmark matrix below through the main and main-md binaries,
+# BENCH_REPS times per configuration, and reduces every point to the mean and
+# standard deviation of cy/elem. The first run on a host stores these numbers
+# as its baseline. Later runs are compared against it: a point regresses if
+# its mean grew by more than both BENCH_TOLERANCE percent and three combined
+# standard deviations. The script prints a table of all points and exits
+# non-zero if any point regressed. The binaries are built in a scratch copy
+# of the sources, the build directory and binaries of the tree are left alone.
+#
+# All settings can be overridden from the environment (make bench passes
+# TAG, ISA and the BENCH_* variables from config.mk).
+
+TAG=${TAG:-ICC}
+ISA=${ISA:-avx512}
+FREQ=${BENCH_FREQ:-2.5}
+REPS=${BENCH_REPS:-3}
+TOLERANCE=${BENCH_TOLERANCE:-5}
+UPDATE=${BENCH_UPDATE:-false}
+# Benchmark matrix: kernel (main = gather, md = gather_<layout>_dims) x
+# layout x stride x N. Each N selects the first row of the sweep with N >= it.
+STRIDES=${BENCH_STRIDES:-"1 3 8"}
+LAYOUTS=${BENCH_LAYOUTS:-"AOS SOA AOSOA"}
+SIZES_MAIN=${BENCH_SIZES_MAIN:-"1024 11664 132859"}
+SIZES_MD=${BENCH_SIZES_MD:-"512 5832 100000"}
+
+VERSION=1
+HOST=$(hostname -s 2>/dev/null || hostname)
+BASELINE=${BENCH_BASELINE:-bench/baselines/${HOST}-${ISA}-${TAG}.csv}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+TREE="$WORK/tree"
+
+die() {
+    echo "bench: $*" >&2
+    exit 2
+}
+
+max_size() {
+    echo "$1" | tr ' ' '\n' | sort -n | tail -1
+}
+
+# Rows of the CSV sweep on stdin selected by the sizes in $1, printed as
+# "<requested N> <cy/elem>"
+select_rows() {
+    awk -F, -v sizes="$1" '
+        BEGIN { n = split(sizes, want, " ") }
+        {
+            for(i = 1; i <= NF; i++) { gsub(/ /, "", $i) }
+        }
+        $1 == "N" {
+            for(i = 1; i <= NF; i++) { if($i == "cy/elem") { col = i } }
+            next
+        }
+        col && $1 ~ /^[0-9]+$/ {
+            for(k = 1; k <= n; k++) {
+                if(!(k in done) && $1 + 0 >= want[k] + 0) {
+                    print want[k], $col
+                    done[k] = 1
+                }
+            }
+        }'
+}
+
+build() {
+    make -s -C "$TREE" clean TAG="$TAG" ISA="$ISA" >/dev/null
+    make -s -C "$TREE" TAG="$TAG" ISA="$ISA" "$@" >/dev/null 2>&1 || die "build failed: make TAG=$TAG ISA=$ISA $*"
+}
+
+# Appends "<key> <cy/elem>" lines for one configuration to $WORK/samples
+run_point() {
+    key=$1
+    sizes=$2
+    shift 2
+    r=0
+    while [ "$r" -lt "$REPS" ]; do
+        "$@" > "$WORK/out" 2>&1 || die "run failed: $*"
+        select_rows "$sizes" < "$WORK/out" | while read -r n cy; do
+            echo "${key}/N${n} ${cy}"
+        done >> "$WORK/samples"
+        r=$((r + 1))
+    done
+}
+
+: > "$WORK/samples"
+mkdir "$TREE"
+cp -R Makefile config.mk include_*.mk src "$TREE" || die "cannot copy the sources to $TREE"
+nmax_main=$(($(max_size "$SIZES_MAIN") * 2))
+nmax_md=$(($(max_size "$SIZES_MD") * 2))
+
+echo "bench: main (gather)"
+build
+for s in $STRIDES; do
+    run_point "main/gather/s${s}" "$SIZES_MAIN" "$TREE/gather-bench-${TAG}" "$s" "$FREQ" 64 "$nmax_main"
+done
+
+for layout in $LAYOUTS; do
+    echo "bench: md ($layout)"
+    build VARIANT=md DATA_LAYOUT="$layout"
+    for s in $STRIDES; do
+        run_point "md/${layout}/s${s}" "$SIZES_MD" "$TREE/gather-bench-${TAG}-md" -s "$s" -f "$FREQ" -n "$nmax_md"
+    done
+done
+
+# key mean stddev reps
+sort "$WORK/samples" | awk '
+    function flush() {
+        if(n) {
+            m = s / n
+            v = (n > 1) ? (ss - n * m * m) / (n - 1) : 0
+            printf "%s,%.6f,%.6f,%d\n", key, m, (v > 0) ? sqrt(v) : 0, n
+        }
+    }
+    $1 != key { flush(); key = $1; s = 0; ss = 0; n = 0 }
+    { s += $2; ss += $2 * $2; n++ }
+    END { flush() }' > "$WORK/current"
+
+write_baseline() {
+    mkdir -p "$(dirname "$BASELINE")"
+    {
+        echo "# gather-bench baseline,version=${VERSION},host=${HOST},isa=${ISA},tag=${TAG},freq=${FREQ},commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown),date=$(date +%Y-%m-%d)"
+        echo "key,mean cy/elem,stddev,reps"
+        cat "$WORK/current"
+    } > "$BASELINE"
+    echo "bench: baseline written to $BASELINE"
+}
+
+if [ "$UPDATE" = "true" ] || [ ! -f "$BASELINE" ]; then
+    write_baseline
+    exit 0
+fi
+
+head -1 "$BASELINE" | grep -q "version=${VERSION}," || die "$BASELINE has another format version, rerun with BENCH_UPDATE=true"
+
+grep -v '^#' "$BASELINE" | tail -n +2 | awk -F, -v tol="$TOLERANCE" '
+    NR == FNR { mean[$1] = $2; sd[$1] = $3; next }
+    {
+        key = $1
+        if(!(key in mean)) {
+            printf "%-32s %12s %12.4f %9s  %s\n", key, "-", $2, "-", "new"
+            next
+        }
+
+        diff = $2 - mean[key]
+        noise = 3 * sqrt(sd[key] * sd[key] + $3 * $3)
+        limit = tol / 100 * mean[key]
+        if(noise > limit) { limit = noise }
+        status = "ok"
+        if(diff > limit) { status = "REGRESSION"; failed++ }
+        else if(-diff > limit) { status = "improved" }
+        printf "%-32s %12.4f %12.4f %+8.2f%%  %s\n", key, mean[key], $2, (mean[key] > 0) ? diff * 100 / mean[key] : 0, status
+    }
+    BEGIN { printf "%-32s %12s %12s %9s  %s\n", "point", "baseline", "current", "delta", "status" }
+    END {
+        if(failed) { printf "\n%d point(s) regressed beyond %s%% and the measured noise\n", failed, tol; exit 1 }
+    }' - "$WORK/current"
@@ -5,9 +5,10 @@ ISA ?= avx512
 # Use likwid?
 ENABLE_LIKWID ?= false
 
-# SP or DP
+# Storage of the MD variant array: DP, SP, HP (half) or BF16 (bfloat16),
+# gathered values are widened to double (AOS and SOA layouts)
 DATA_TYPE ?= DP
-# AOS or SOA
+# AOS, SOA or AOSOA (block size is given at runtime)
 DATA_LAYOUT ?= AOS
 # Padding byte for AoS
 PADDING ?= false
@@ -15,8 +16,41 @@ PADDING ?= false
 MEASURE_GATHER_CYCLES ?= false
 # Gather data only for first dimension (one gather per iteration)
 ONLY_FIRST_DIMENSION ?= false
+# Compare AoS gathers against kernels gathering repeated indices only once
+COALESCE ?= false
 
 # Trace memory addresses for cache simulator
 MEM_TRACER ?= false
+# WARM, FLUSH (flush a and idx before each cold rep), EVICT (stream through a
+# buffer larger than the LLC) or IDX_ONLY (flush a, keep idx warm)
+CACHE_STATE ?= WARM
+# Co-running memory traffic: pinned background threads running COPY, TRIAD or
+# RANDOM, optionally a second gather stream on the SMT sibling
+INTERFERENCE ?= false
+BG_THREADS ?= 2
+BG_KERNEL ?= TRIAD
+BG_SMT_GATHER ?= false
 # Test correctness of gather kernels
 TEST ?= false
+# Compare in-register permute lookups against gathers for small tables
+PERMUTE ?= false
+# Sweep the number of independent gathers per iteration (1, 2, 4, 8, 16)
+ILP_SWEEP ?= false
+# Gather from 1, 2, 4 and 8 separately allocated double/float/int arrays with
+# one index vector, and in one pass per array
+MULTI_ARRAY ?= false
+# Measure the latency of dependent gathers (pointer chasing)
+LATENCY ?= false
+# Run the C++ intrinsics kernels (gather_kernels.cc) next to the hand-written
+# ones in the MD variant, with 1, 2 and 4 index vectors per iteration
+INTRINSICS ?= false
+
+# make bench: stride and layout matrix, runs per point, regression tolerance
+# in percent and clock frequency (GHz) passed to the binaries
+BENCH_STRIDES ?= 1 3 8
+BENCH_LAYOUTS ?= AOS SOA AOSOA
+BENCH_REPS ?= 3
+BENCH_TOLERANCE ?= 5
+BENCH_FREQ ?= 2.5
+# Overwrite the stored baseline of this host with the new run
+BENCH_UPDATE ?= false
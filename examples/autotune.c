@@ -0,0 +1,79 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+//---
+#include <gatherbench.h>
+
+// Picks the fastest gather kernel and data layout for an index pattern at
+// startup, the way an application would before choosing its data structures.
+// The indices here are random, an application would pass its own.
+int main (int argc, char** argv) {
+    const int N = (argc > 1) ? atoi(argv[1]) : 100000;
+    const int dims = (argc > 2) ? atoi(argv[2]) : 3;
+    const double freq = (argc > 3) ? atof(argv[3]) : 2.5;
+    const gb_kernel_t kernels[] = {GB_KERNEL_DIMS, GB_KERNEL_COALESCE};
+    const gb_layout_t layouts[] = {GB_LAYOUT_AOS, GB_LAYOUT_SOA, GB_LAYOUT_AOSOA};
+    int* idx = (int*) malloc(N * sizeof(int));
+    double best = -1.0;
+    int best_k = 0, best_l = 0;
+
+    srand48(42);
+    for(int i = 0; i < N; ++i) {
+        idx[i] = lrand48() % N;
+    }
+
+    printf("ISA %s, vector width %d, N %d, dims %d\n", gatherbench_isa(), gatherbench_vector_width(), N, dims);
+    printf("%10s,%10s,%14s\n", "kernel", "layout", "cy/elem");
+    for(int k = 0; k < 2; ++k) {
+        for(int l = 0; l < 3; ++l) {
+            gatherbench_t bench = { .kernel = kernels[k], .layout = layouts[l], .index = GB_INDEX_USER, .user_idx = idx, .N = N, .dims = dims, .freq = freq };
+            gatherbench_result_t res;
+
+            if(!gatherbench_supported(&bench)) {
+                continue;
+            }
+
+            if(!gatherbench_init(&bench) || !gatherbench_run(&bench, &res)) {
+                return EXIT_FAILURE;
+            }
+
+            printf("%10s,%10s,%14.6f\n", gatherbench_kernel_name(kernels[k]), gatherbench_layout_name(layouts[l]), res.cy_per_elem);
+            if(best < 0.0 || res.cy_per_elem < best) {
+                best = res.cy_per_elem;
+                best_k = k;
+                best_l = l;
+            }
+
+            gatherbench_free(&bench);
+        }
+    }
+
+    printf("\nSelected %s kernel with %s layout (%.6f cy/elem)\n", gatherbench_kernel_name(kernels[best_k]), gatherbench_layout_name(layouts[best_l]), best);
+    free(idx);
+    return EXIT_SUCCESS;
+}
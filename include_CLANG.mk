@@ -1,9 +1,11 @@
 CC  = clang
+CXX = clang++
 LINKER = $(CC)
 
 OPENMP   =# -fopenmp
 CFLAGS   = -Ofast -std=c11 -march=core-avx2 -mavx -mfma  $(OPENMP)
+CXXFLAGS = -Ofast -std=c++17 -march=core-avx2 -mavx -mfma $(OPENMP) -fno-exceptions -fno-rtti
 LFLAGS   = $(OPENMP) -march=core-avx2 -mavx -mfma
 DEFINES  = -D_GNU_SOURCE
 INCLUDES =
-LIBS     =
+LIBS     = -lm
@@ -1,4 +1,5 @@
 CC  = gcc
+CXX = g++
 AS  = as
 LINKER = $(CC)
 
@@ -6,13 +7,16 @@ OPENMP   = -fopenmp
 
 ifeq ($(strip $(ISA)),sve)
 ARCHFLAGS = -march=armv8-a+sve2
+else ifeq ($(strip $(ISA)),avx512)
+ARCHFLAGS = -mavx512f -mavx512vl -mavx512bw -mfma
 else
 ARCHFLAGS = -mavx2 -mfma
 endif
 
 CFLAGS   = -Ofast -std=c11 $(ARCHFLAGS) $(OPENMP)
+CXXFLAGS = -Ofast -std=c++17 $(ARCHFLAGS) $(OPENMP) -fno-exceptions -fno-rtti
 ASFLAGS  =
 LFLAGS   = $(OPENMP) $(ARCHFLAGS)
 DEFINES  = -D_GNU_SOURCE
 INCLUDES =
-LIBS     =
+LIBS     = -lm
@@ -1,9 +1,11 @@
 CC  = icc
+CXX = icpc
 LINKER = $(CC)
 
 OPENMP   = -qopenmp
 CFLAGS   = -Ofast -xhost -std=c11 $(OPENMP)
+CXXFLAGS = -Ofast -xhost -std=c++17 $(OPENMP) -fno-exceptions -fno-rtti
 LFLAGS   = $(OPENMP)
 DEFINES  = -D_GNU_SOURCE
 INCLUDES =
-LIBS     =
+LIBS     = -lm
@@ -0,0 +1,102 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <stdlib.h>
+#include <string.h>
+//---
+#include <allocate.h>
+#include <cache_state.h>
+
+// Buffer streamed through to evict all cache levels, must exceed the LLC
+#ifndef EVICT_MB
+#define EVICT_MB  256
+#endif
+
+#if !defined(CACHE_FLUSH) && (defined(CACHE_EVICT) || defined(CACHE_IDX_ONLY))
+static volatile long cache_sink;
+
+static void touch(const char* ptr, size_t bytes)
+{
+    long sum = 0;
+
+    for(size_t i = 0; i < bytes; i += 64) {
+        sum += ptr[i];
+    }
+
+    cache_sink = sum;
+}
+#endif
+
+#if !defined(CACHE_FLUSH) && defined(CACHE_EVICT)
+static char* evict_buffer = NULL;
+
+static void evict_caches()
+{
+    const size_t bytes = (size_t) EVICT_MB * 1024 * 1024;
+
+    if(evict_buffer == NULL) {
+        // Written once so the reads below are not served by the zero page
+        evict_buffer = (char*) allocate(64, bytes);
+        memset(evict_buffer, 1, bytes);
+    }
+
+    touch(evict_buffer, bytes);
+}
+#endif
+
+void prepare_cache(void* a, size_t a_bytes, void* idx, size_t idx_bytes)
+{
+    // Not every cache state needs the arrays
+    (void) a;
+    (void) a_bytes;
+    (void) idx;
+    (void) idx_bytes;
+
+#if defined(CACHE_FLUSH)
+    flush_lines(a, a_bytes);
+    flush_lines(idx, idx_bytes);
+#elif defined(CACHE_EVICT)
+    evict_caches();
+#elif defined(CACHE_IDX_ONLY)
+    flush_lines(a, a_bytes);
+    touch((const char*) idx, idx_bytes);
+#endif
+}
+
+static int compare_double(const void* x, const void* y)
+{
+    const double dx = *(const double*) x;
+    const double dy = *(const double*) y;
+    return (dx > dy) - (dx < dy);
+}
+
+void cold_summary(double* times, int n, double* min, double* med, double* max)
+{
+    qsort(times, n, sizeof(double), compare_double);
+    *min = times[0];
+    *med = times[n / 2];
+    *max = times[n - 1];
+}
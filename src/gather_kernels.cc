@@ -0,0 +1,251 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <stddef.h>
+#include <utility>
+#if defined(ISA_sve)
+#include <arm_sve.h>
+#else
+#include <immintrin.h>
+#endif
+//---
+#include <aosoa.h>
+#include <gather_kernels.h>
+
+#if !defined(ISA_avx2) && !defined (ISA_avx512) && !defined(ISA_sve)
+#error "Invalid ISA macro, possible values are: avx2, avx512 and sve"
+#endif
+
+#define MAX_DIMS  16
+
+// Vector operations of the ISA the kernels are generated for. pred_t masks
+// the lanes of the last vector (first(i, n)). The full mask of all() is
+// hidden from the compiler on avx2 and avx512: for a known full mask it
+// drops the zeroed merge source and chains the gathers through a reused
+// destination register. Gathered values are widened to double and kept
+// alive by sink when they are not stored.
+#if defined(ISA_avx512)
+struct isa {
+    typedef __m512d vec_t;
+    typedef __m256i idx_t;
+    typedef __mmask8 pred_t;
+
+    static int lanes() { return 8; }
+    static pred_t all() {
+        pred_t m = 0xff;
+        __asm__("" : "+r"(m));
+        return m;
+    }
+    static pred_t first(int i, int n) { return (n - i >= 8) ? 0xff : (pred_t) ((1 << (n - i)) - 1); }
+    static idx_t load(pred_t pg, const int* p) { return _mm256_maskz_loadu_epi32(pg, p); }
+    static idx_t mul(pred_t, idx_t x, int n) { return _mm256_mullo_epi32(x, _mm256_set1_epi32(n)); }
+    static idx_t shift_and_mask(pred_t, idx_t x, int shift, int mask, idx_t* low) {
+        *low = _mm256_and_si256(x, _mm256_set1_epi32(mask));
+        return _mm256_srli_epi32(x, shift);
+    }
+    static idx_t add(pred_t, idx_t x, idx_t y) { return _mm256_add_epi32(x, y); }
+    static vec_t gather(pred_t pg, const double* a, idx_t i) {
+        return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), pg, i, a, 8);
+    }
+    static vec_t gather(pred_t pg, const float* a, idx_t i) {
+        return _mm512_cvtps_pd(_mm256_mmask_i32gather_ps(_mm256_setzero_ps(), pg, i, a, 4));
+    }
+    static void store(pred_t pg, double* t, vec_t v) { _mm512_mask_storeu_pd(t, pg, v); }
+    static void sink(vec_t v) { __asm__ volatile("" :: "v"(v)); }
+};
+#elif defined(ISA_avx2)
+struct isa {
+    typedef __m256d vec_t;
+    typedef __m128i idx_t;
+    // Lane masks for dword indices and floats (m32) and doubles (m64)
+    struct pred_t {
+        __m128i m32;
+        __m256i m64;
+    };
+
+    static int lanes() { return 4; }
+    static pred_t all() {
+        __m128i m = _mm_set1_epi32(-1);
+        __asm__("" : "+x"(m));
+        return pred_t{m, _mm256_cvtepi32_epi64(m)};
+    }
+    static pred_t first(int i, int n) {
+        const __m128i m = _mm_cmpgt_epi32(_mm_set1_epi32(n - i), _mm_setr_epi32(0, 1, 2, 3));
+        return pred_t{m, _mm256_cvtepi32_epi64(m)};
+    }
+    static idx_t load(pred_t pg, const int* p) { return _mm_maskload_epi32(p, pg.m32); }
+    static idx_t mul(pred_t, idx_t x, int n) { return _mm_mullo_epi32(x, _mm_set1_epi32(n)); }
+    static idx_t shift_and_mask(pred_t, idx_t x, int shift, int mask, idx_t* low) {
+        *low = _mm_and_si128(x, _mm_set1_epi32(mask));
+        return _mm_srli_epi32(x, shift);
+    }
+    static idx_t add(pred_t, idx_t x, idx_t y) { return _mm_add_epi32(x, y); }
+    static vec_t gather(pred_t pg, const double* a, idx_t i) {
+        return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), a, i, _mm256_castsi256_pd(pg.m64), 8);
+    }
+    static vec_t gather(pred_t pg, const float* a, idx_t i) {
+        return _mm256_cvtps_pd(_mm_mask_i32gather_ps(_mm_setzero_ps(), a, i, _mm_castsi128_ps(pg.m32), 4));
+    }
+    static void store(pred_t pg, double* t, vec_t v) { _mm256_maskstore_pd(t, pg.m64, v); }
+    static void sink(vec_t v) { __asm__ volatile("" :: "x"(v)); }
+};
+#else
+// Indices are sign-extended to 64-bit lanes, as in the hand-written kernels
+struct isa {
+    typedef svfloat64_t vec_t;
+    typedef svint64_t idx_t;
+    typedef svbool_t pred_t;
+
+    static int lanes() { return (int) svcntd(); }
+    static pred_t all() { return svptrue_b64(); }
+    static pred_t first(int i, int n) { return svwhilelt_b64(i, n); }
+    static idx_t load(pred_t pg, const int* p) { return svld1sw_s64(pg, p); }
+    static idx_t mul(pred_t pg, idx_t x, int n) { return svmul_n_s64_x(pg, x, n); }
+    static idx_t shift_and_mask(pred_t pg, idx_t x, int shift, int mask, idx_t* low) {
+        *low = svand_n_s64_x(pg, x, mask);
+        return svasr_n_s64_x(pg, x, shift);
+    }
+    static idx_t add(pred_t pg, idx_t x, idx_t y) { return svadd_s64_x(pg, x, y); }
+    static vec_t gather(pred_t pg, const double* a, idx_t i) { return svld1_gather_s64index_f64(pg, a, i); }
+    static vec_t gather(pred_t pg, const float* a, idx_t i) {
+        svuint64_t w = svld1uw_gather_s64index_u64(pg, (const uint32_t*) a, i);
+        return svcvt_f64_f32_x(pg, svreinterpret_f32_u64(w));
+    }
+    static void store(pred_t pg, double* t, vec_t v) { svst1_f64(pg, t, v); }
+    static void sink(vec_t v) { __asm__ volatile("" :: "w"(v)); }
+};
+#endif
+
+// Layout arguments of one kernel call, for AoSoA the block size, its log2
+// and the components per element
+struct layout_args {
+    int arg;
+    int log2_block;
+    int dims;
+};
+
+// Gathers the D components of elements idx[i..i + VL - 1]
+template<typename T, int D, gb_layout_t L>
+static inline void gather_vector(isa::pred_t pg, const T* a, const int* idx, int i, int N, double* t, layout_args l) {
+    isa::idx_t off = isa::load(pg, &idx[i]);
+    long stride;
+
+    if(L == GB_LAYOUT_AOS) {
+        off = isa::mul(pg, off, l.arg);
+        stride = 1;
+    } else if(L == GB_LAYOUT_AOSOA) {
+        isa::idx_t low;
+        isa::idx_t block = isa::shift_and_mask(pg, off, l.log2_block, l.arg - 1, &low);
+        off = isa::add(pg, isa::mul(pg, block, l.arg * l.dims), low);
+        stride = l.arg;
+    } else {
+        stride = l.arg;
+    }
+
+    for(int d = 0; d < D; d++) {
+        isa::vec_t v = isa::gather(pg, &a[d * stride], off);
+#ifdef TEST
+        isa::store(pg, &t[(long) d * N + i], v);
+#else
+        (void) t;
+        (void) N;
+        isa::sink(v);
+#endif
+    }
+}
+
+// U index vectors per iteration of the main loop, single vectors for the rest
+template<typename T, int D, gb_layout_t L, int U>
+static void gather_kernel(void* a, int* idx, int N, double* t, int layout_arg) {
+    const T* base = (const T*) a;
+    const int vl = isa::lanes();
+    layout_args l = {layout_arg, 0, D};
+    int i = 0;
+
+    if(L == GB_LAYOUT_AOSOA) {
+        l.arg = AOSOA_ARG_BLOCK(layout_arg);
+        l.dims = AOSOA_ARG_DIMS(layout_arg);
+    }
+
+    while((1 << l.log2_block) < l.arg) {
+        l.log2_block++;
+    }
+
+    for(; i + U * vl <= N; i += U * vl) {
+        for(int u = 0; u < U; u++) {
+            gather_vector<T, D, L>(isa::all(), base, idx, i + u * vl, N, t, l);
+        }
+    }
+
+    for(; i < N; i += vl) {
+        gather_vector<T, D, L>(isa::first(i, N), base, idx, i, N, t, l);
+    }
+}
+
+struct kernel_table {
+    gather_kernel_t kernels[MAX_DIMS];
+};
+
+template<typename T, gb_layout_t L, int U, int... D>
+static constexpr kernel_table make_table(std::integer_sequence<int, D...>) {
+    return kernel_table{ { &gather_kernel<T, D + 1, L, U>... } };
+}
+
+template<typename T, gb_layout_t L, int U>
+static constexpr kernel_table table = make_table<T, L, U>(std::make_integer_sequence<int, MAX_DIMS>{});
+
+template<typename T, gb_layout_t L>
+static gather_kernel_t lookup_unroll(int dims, int unroll) {
+    switch(unroll) {
+        case 1:     return table<T, L, 1>.kernels[dims - 1];
+        case 2:     return table<T, L, 2>.kernels[dims - 1];
+        case 4:     return table<T, L, 4>.kernels[dims - 1];
+        default:    return NULL;
+    }
+}
+
+template<typename T>
+static gather_kernel_t lookup_layout(gb_layout_t layout, int dims, int unroll) {
+    switch(layout) {
+        case GB_LAYOUT_AOS:     return lookup_unroll<T, GB_LAYOUT_AOS>(dims, unroll);
+        case GB_LAYOUT_AOSOA:   return lookup_unroll<T, GB_LAYOUT_AOSOA>(dims, unroll);
+        default:                return lookup_unroll<T, GB_LAYOUT_SOA>(dims, unroll);
+    }
+}
+
+const int gather_kernel_unrolls[GATHER_KERNEL_UNROLLS] = {1, 2, 4};
+
+gather_kernel_t gather_kernel_lookup(gb_layout_t layout, gb_precision_t precision, int dims, int unroll) {
+    if(dims < 1 || dims > MAX_DIMS) {
+        return NULL;
+    }
+
+    switch(precision) {
+        case GB_DOUBLE:     return lookup_layout<double>(layout, dims, unroll);
+        case GB_FLOAT:      return lookup_layout<float>(layout, dims, unroll);
+        default:            return NULL;
+    }
+}
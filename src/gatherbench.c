@@ -0,0 +1,815 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+//---
+#include <likwid-marker.h>
+//---
+#include <allocate.h>
+#include <aosoa.h>
+#include <cache_state.h>
+#include <gather_kernels.h>
+#include <gatherbench.h>
+#include <timing.h>
+
+#if !defined(ISA_avx2) && !defined (ISA_avx512) && !defined(ISA_sve)
+#error "Invalid ISA macro, possible values are: avx2, avx512 and sve"
+#endif
+
+#ifndef MIN
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#endif
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+
+#define ARRAY_ALIGNMENT  64
+#define MAX_DIMS  16
+#define PAGE_SIZE  4096
+
+#if defined(ISA_avx512)
+#define _VL_  8
+#define ISA_STRING "avx512"
+#elif defined(ISA_sve)
+#define _VL_  2
+#define ISA_STRING "sve"
+#else
+#define _VL_  4
+#define ISA_STRING "avx2"
+#endif
+
+extern void gather(double*, int*, int, double*);
+
+// Generated kernels gathering D = 1..MAX_DIMS components, indexed by D - 1
+typedef void (*gather_dims_t)(double*, int*, int, double*, int);
+extern gather_dims_t gather_aos_dims[MAX_DIMS];
+extern gather_dims_t gather_soa_dims[MAX_DIMS];
+extern gather_dims_t gather_aosoa_dims[MAX_DIMS];
+
+// Same for arrays of float, half and bfloat16 widened to double on gather
+typedef void (*gather_widen_dims_t)(void*, int*, int, double*, int);
+extern gather_widen_dims_t gather_aos_f32_dims[MAX_DIMS];
+extern gather_widen_dims_t gather_soa_f32_dims[MAX_DIMS];
+extern gather_widen_dims_t gather_aos_f16_dims[MAX_DIMS];
+extern gather_widen_dims_t gather_soa_f16_dims[MAX_DIMS];
+extern gather_widen_dims_t gather_aos_bf16_dims[MAX_DIMS];
+extern gather_widen_dims_t gather_soa_bf16_dims[MAX_DIMS];
+
+#ifndef ISA_sve
+extern gather_dims_t gather_aos_coalesce_dims[MAX_DIMS];
+extern int gather_md_aosoa(double*, int*, int, double*, int, int);
+extern void load_aosoa(double*, int);
+#endif
+
+#ifdef ISA_avx512
+extern int gather_md_aos(double*, int*, int, double*, int);
+extern void load_aos(double*);
+#endif
+
+static int log2_uint(unsigned int x) {
+    int ans = 0;
+    while(x >>= 1) { ans++; }
+    return ans;
+}
+
+// Distinct cache lines touched by n records of width bytes each, placed
+// spacing bytes apart starting at a cache line boundary
+static size_t count_cache_lines(size_t spacing, size_t width, int n, int cl_size) {
+    size_t lines = 0;
+    long int last_counted = -1;
+    for(int j = 0; j < n; j++) {
+        long int first_cl = (long int)((j * spacing) / cl_size);
+        long int last_cl = (long int)((j * spacing + width - 1) / cl_size);
+        if(last_cl > last_counted) {
+            lines += last_cl - MAX(first_cl, last_counted + 1) + 1;
+            last_counted = last_cl;
+        }
+    }
+
+    return lines;
+}
+
+// Distinct cache lines touched by one vector of n elements placed stride
+// elements apart in AoSoA layout
+static size_t count_aosoa_cache_lines(int stride, int block, int dims, int gathered_dims, int n, int cl_size) {
+    long int lines[_VL_ * MAX_DIMS];
+    size_t nlines = 0;
+    for(int j = 0; j < n; j++) {
+        for(int d = 0; d < gathered_dims; d++) {
+            long int cl = AOSOA_IDX((long int) j * stride, d, block, dims) * sizeof(double) / cl_size;
+            size_t k = 0;
+            while(k < nlines && lines[k] != cl) { k++; }
+            if(k == nlines) {
+                lines[nlines++] = cl;
+            }
+        }
+    }
+
+    return nlines;
+}
+
+// Small indices are the most frequent
+int gatherbench_zipf_index(int n, double s) {
+    const double u = drand48();
+    double x;
+    if(fabs(s - 1.0) < 1e-9) {
+        x = pow(n + 1.0, u);
+    } else {
+        x = pow((pow(n + 1.0, 1.0 - s) - 1.0) * u + 1.0, 1.0 / (1.0 - s));
+    }
+
+    return MIN(MAX((int) x - 1, 0), n - 1);
+}
+
+static int element_size(gb_precision_t precision) {
+    switch(precision) {
+        case GB_FLOAT:      return 4;
+        case GB_HALF:
+        case GB_BFLOAT16:   return 2;
+        default:            return 8;
+    }
+}
+
+// Stored values are taken modulo the first integer the format cannot
+// represent exactly, so widened values can be checked for equality
+static long value_range(gb_precision_t precision) {
+    switch(precision) {
+        case GB_FLOAT:      return 1L << 24;
+        case GB_HALF:       return 1L << 11;
+        case GB_BFLOAT16:   return 1L << 8;
+        default:            return 1L << 53;
+    }
+}
+
+// Half precision bits of an integer valued float below 2048
+static uint16_t float_to_half(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    if(x == 0.0f) {
+        return 0;
+    }
+
+    const uint32_t exponent = ((bits >> 23) & 0xff) - 127 + 15;
+    return (uint16_t)(exponent << 10 | ((bits >> 13) & 0x3ff));
+}
+
+static void store(gatherbench_t* gb, long pos, long value) {
+    const float x = (float)(value % value_range(gb->precision));
+    uint32_t bits;
+
+    switch(gb->precision) {
+        case GB_FLOAT:
+            ((float*) gb->a)[pos] = x;
+            break;
+        case GB_HALF:
+            ((uint16_t*) gb->a)[pos] = float_to_half(x);
+            break;
+        case GB_BFLOAT16:
+            memcpy(&bits, &x, sizeof(bits));
+            ((uint16_t*) gb->a)[pos] = (uint16_t)(bits >> 16);
+            break;
+        default:
+            ((double*) gb->a)[pos] = (double) value;
+            break;
+    }
+}
+
+static void apply_defaults(gatherbench_t* gb) {
+    if(gb->stride == 0) { gb->stride = 1; }
+    if(gb->dims == 0) { gb->dims = (gb->kernel == GB_KERNEL_GATHER) ? 1 : 3; }
+    if(gb->gathered_dims == 0) { gb->gathered_dims = gb->dims; }
+    if(gb->width == 0) { gb->width = gb->dims; }
+    if(gb->block == 0) { gb->block = _VL_; }
+    if(gb->cl_size == 0) { gb->cl_size = 64; }
+    if(gb->freq == 0.0) { gb->freq = 2.5; }
+    if(gb->unroll == 0) { gb->unroll = 1; }
+}
+
+const char* gatherbench_isa() {
+    return ISA_STRING;
+}
+
+int gatherbench_vector_width() {
+    return _VL_;
+}
+
+const char* gatherbench_kernel_name(gb_kernel_t kernel) {
+    switch(kernel) {
+        case GB_KERNEL_GATHER:      return "gather";
+        case GB_KERNEL_DIMS:        return "dims";
+        case GB_KERNEL_COALESCE:    return "coalesce";
+        case GB_KERNEL_MD:          return "md";
+    }
+
+    return "unknown";
+}
+
+const char* gatherbench_layout_name(gb_layout_t layout) {
+    switch(layout) {
+        case GB_LAYOUT_AOS:         return "AoS";
+        case GB_LAYOUT_SOA:         return "SoA";
+        case GB_LAYOUT_AOSOA:       return "AoSoA";
+    }
+
+    return "unknown";
+}
+
+const char* gatherbench_precision_name(gb_precision_t precision) {
+    switch(precision) {
+        case GB_DOUBLE:             return "double";
+        case GB_FLOAT:              return "float";
+        case GB_HALF:               return "half";
+        case GB_BFLOAT16:           return "bfloat16";
+    }
+
+    return "unknown";
+}
+
+// Kernels gathering the last partial vector of any N with masked lanes: the
+// plain gather, the double AoS and SoA layout kernels and all generated ones
+static int masked_tail(const gatherbench_t* gb) {
+    if(gb->kernel == GB_KERNEL_GATHER) {
+        return 1;
+    }
+    if(gb->kernel != GB_KERNEL_DIMS) {
+        return 0;
+    }
+    return gb->generated || (gb->precision == GB_DOUBLE && gb->layout != GB_LAYOUT_AOSOA);
+}
+
+// Reason why the configuration cannot run in this build, NULL if it can
+static const char* unsupported(const gatherbench_t* gb) {
+    if(gb->N < 1) {
+        return "N must be positive";
+    }
+
+    if(gb->dims < 1 || gb->dims > MAX_DIMS) {
+        return "number of dimensions must be between 1 and 16";
+    }
+
+    if(gb->gathered_dims < 1 || gb->gathered_dims > gb->dims) {
+        return "gathered dimensions must be between 1 and dims";
+    }
+
+    if(gb->width < gb->dims) {
+        return "struct width cannot be smaller than the number of dimensions";
+    }
+
+    if(gb->block < 1 || gb->block > AOSOA_MAX_BLOCK || (gb->block & (gb->block - 1)) != 0) {
+        return "block size must be a power of two up to 32768";
+    }
+
+    if((gb->kernel == GB_KERNEL_MD) != (gb->index == GB_INDEX_NEIGHBORS)) {
+        return "neighbor lists are used by the MD kernel only";
+    }
+
+    if(gb->generated) {
+        if(gb->kernel != GB_KERNEL_DIMS) {
+            return "generated kernels are only available for the dims kernel";
+        }
+
+        if(gather_kernel_lookup(gb->layout, gb->precision, gb->gathered_dims, gb->unroll) == NULL) {
+            return "generated kernels are available for double and float with an unroll of 1, 2 or 4";
+        }
+    } else if(gb->precision != GB_DOUBLE && (gb->kernel != GB_KERNEL_DIMS || gb->layout == GB_LAYOUT_AOSOA)) {
+        return "reduced precision is only available for AoS and SoA dims kernels";
+    }
+
+    if(gb->index == GB_INDEX_USER) {
+        if(gb->user_idx == NULL) {
+            return "user indices not given";
+        }
+
+        // N would be rounded up past the end of the given indices
+        if(!masked_tail(gb) && gb->N % _VL_ != 0) {
+            return "user indices require N to be a multiple of the vector length for this kernel";
+        }
+
+        for(int i = 0; i < gb->N; ++i) {
+            if(gb->user_idx[i] < 0 || gb->user_idx[i] >= gb->N) {
+                return "user indices must be in [0, N)";
+            }
+        }
+    }
+
+    switch(gb->kernel) {
+        case GB_KERNEL_GATHER:
+            if(gb->dims != 1) {
+                return "gather kernel gathers a single component";
+            }
+            break;
+
+        case GB_KERNEL_DIMS:
+            break;
+
+        case GB_KERNEL_COALESCE:
+#ifdef ISA_sve
+            return "coalesce kernels are not available for sve";
+#endif
+            if(gb->layout != GB_LAYOUT_AOS) {
+                return "coalesce kernels require the AoS layout";
+            }
+            break;
+
+        case GB_KERNEL_MD:
+            if(gb->neighborlists == NULL || gb->numneighs == NULL || gb->nlocal > gb->N) {
+                return "invalid neighbor lists";
+            }
+
+            if(gb->dims != 3) {
+                return "MD kernels gather 3 components";
+            }
+#ifdef ISA_avx512
+            if(gb->layout == GB_LAYOUT_SOA) {
+                return "MD kernels are available for AoS and AoSoA on avx512";
+            }
+#elif defined(ISA_avx2)
+            if(gb->layout != GB_LAYOUT_AOSOA) {
+                return "MD kernels are only available for AoSoA on avx2";
+            }
+#else
+            return "MD kernels are not available for sve";
+#endif
+            break;
+
+        default:
+            return "unknown kernel";
+    }
+
+    return NULL;
+}
+
+int gatherbench_supported(const gatherbench_t* gb) {
+    gatherbench_t tmp = *gb;
+    apply_defaults(&tmp);
+    return unsupported(&tmp) == NULL;
+}
+
+// Distinct cache lines touched by one gathered vector with the stride index
+// source, MD lists are not counted
+size_t gatherbench_cache_lines_per_gather(const gatherbench_t* gb) {
+    gatherbench_t p = *gb;
+    const size_t bytesPerWord = element_size(p.precision);
+    apply_defaults(&p);
+
+    switch(p.kernel) {
+        case GB_KERNEL_GATHER:
+            return MIN(MAX(p.stride * _VL_ / (p.cl_size / sizeof(double)), 1), _VL_);
+
+        case GB_KERNEL_MD:
+            return 0;
+
+        default:
+            break;
+    }
+
+    if(p.layout == GB_LAYOUT_AOS) {
+        return count_cache_lines(p.stride * p.width * bytesPerWord, p.gathered_dims * bytesPerWord, _VL_, p.cl_size);
+    } else if(p.layout == GB_LAYOUT_AOSOA) {
+        return count_aosoa_cache_lines(p.stride, p.block, p.dims, p.gathered_dims, _VL_, p.cl_size);
+    }
+
+    return count_cache_lines(p.stride * bytesPerWord, bytesPerWord, _VL_, p.cl_size) * p.gathered_dims;
+}
+
+// Byte offset of component d of element i in a
+static size_t element_offset(const gatherbench_t* gb, long i, int d) {
+    if(gb->kernel == GB_KERNEL_GATHER) {
+        return i * gb->esize;
+    }
+
+    switch(gb->layout) {
+        case GB_LAYOUT_AOS:     return (i * gb->width + d) * gb->esize;
+        case GB_LAYOUT_AOSOA:   return AOSOA_IDX(i, (long) d, (long) gb->block, (long) gb->dims) * gb->esize;
+        default:                return ((long) d * gb->layout_arg + i) * gb->esize;
+    }
+}
+
+static void mark(uint64_t* bits, size_t k, long* count) {
+    const uint64_t bit = 1UL << (k & 63);
+    if(!(bits[k >> 6] & bit)) {
+        bits[k >> 6] |= bit;
+        (*count)++;
+    }
+}
+
+// Distinct components, cache lines and pages of a touched by one pass, MD
+// passes also load the position of each local atom
+static void count_touched(gatherbench_t* gb) {
+    const uintptr_t base = (uintptr_t) gb->a;
+    const size_t cl_size = gb->cl_size;
+    const size_t first_line = base / cl_size;
+    const size_t first_page = base / PAGE_SIZE;
+    const size_t nwords = gb->a_bytes / gb->esize + 1;
+    const size_t nlines = (base + gb->a_bytes) / cl_size - first_line + 1;
+    const size_t npages = (base + gb->a_bytes) / PAGE_SIZE - first_page + 1;
+    uint64_t* words = (uint64_t*) calloc(nwords / 64 + 1, sizeof(uint64_t));
+    uint64_t* lines = (uint64_t*) calloc(nlines / 64 + 1, sizeof(uint64_t));
+    uint64_t* pages = (uint64_t*) calloc(npages / 64 + 1, sizeof(uint64_t));
+
+    gb->words = 0;
+    gb->lines = 0;
+    gb->pages = 0;
+
+#define TOUCH(i, d) do { \
+        const size_t off = element_offset(gb, (i), (d)); \
+        const uintptr_t addr = base + off; \
+        mark(words, off / gb->esize, &gb->words); \
+        mark(lines, addr / cl_size - first_line, &gb->lines); \
+        mark(pages, addr / PAGE_SIZE - first_page, &gb->pages); \
+    } while(0)
+
+    if(gb->kernel == GB_KERNEL_MD) {
+        for(int i = 0; i < gb->nlocal; i++) {
+            const int* neighbors = &gb->neighborlists[i * gb->maxneighs];
+            for(int d = 0; d < gb->gathered_dims; d++) {
+                TOUCH(i, d);
+                for(int j = 0; j < gb->numneighs[i]; j++) {
+                    TOUCH(neighbors[j], d);
+                }
+            }
+        }
+    } else {
+        for(int i = 0; i < gb->N; i++) {
+            for(int d = 0; d < gb->gathered_dims; d++) {
+                TOUCH(gb->idx[i], d);
+            }
+        }
+    }
+
+#undef TOUCH
+    free(words);
+    free(lines);
+    free(pages);
+}
+
+// Buffer of at least bytes, an earlier one is kept if it is large enough so
+// that repeated inits (e.g. at every reneighboring) reuse faulted-in pages
+static void* reserve(void* p, size_t* capacity, size_t bytes) {
+    if(p != NULL && *capacity >= bytes) {
+        return p;
+    }
+
+    free(p);
+    *capacity = bytes;
+    return allocate( ARRAY_ALIGNMENT, bytes );
+}
+
+void gatherbench_free(gatherbench_t* gb) {
+    free(gb->a);
+    free(gb->idx);
+    free(gb->t);
+    free(gb->f);
+    gb->a = NULL;
+    gb->idx = NULL;
+    gb->t = NULL;
+    gb->f = NULL;
+    gb->N_alloc = 0;
+    gb->a_capacity = 0;
+    gb->idx_capacity = 0;
+    gb->t_capacity = 0;
+    gb->f_capacity = 0;
+}
+
+int gatherbench_init(gatherbench_t* gb) {
+    apply_defaults(gb);
+
+    const char* reason = unsupported(gb);
+    if(reason != NULL) {
+        fprintf(stderr, "gatherbench: %s %s kernel: %s!\n", gatherbench_layout_name(gb->layout), gatherbench_kernel_name(gb->kernel), reason);
+        return 0;
+    }
+
+    // The remaining kernels only work when the array size (in elements) is
+    // a multiple of the vector length (no masked last vector)
+    if(!masked_tail(gb) && gb->kernel != GB_KERNEL_MD) {
+        if(gb->N % _VL_ != 0) {
+            gb->N += _VL_ - (gb->N % _VL_);
+        }
+    }
+
+    const int N = gb->N;
+    const int N_alloc = N * 2;
+    const int dims = gb->dims;
+    const int width = gb->width;
+    const int block = gb->block;
+
+    const int esize = element_size(gb->precision);
+
+    gb->N_alloc = N_alloc;
+    gb->esize = esize;
+
+    if(gb->kernel == GB_KERNEL_GATHER) {
+        gb->a = reserve(gb->a, &gb->a_capacity, N_alloc * sizeof(double));
+        gb->a_bytes = N * sizeof(double);
+        for(int i = 0; i < N_alloc; ++i) {
+            store(gb, i, i);
+        }
+    } else {
+        // 16 bit formats are gathered as dwords and may read 2 bytes past
+        // the last component
+        gb->a = reserve(gb->a, &gb->a_capacity, (N_alloc + block) * width * esize + sizeof(int));
+        gb->a_bytes = (N_alloc + block) * width * esize;
+        for(int i = 0; i < N_alloc; ++i) {
+            for(int d = 0; d < dims; d++) {
+                if(gb->layout == GB_LAYOUT_AOS) {
+                    store(gb, (long) i * width + d, (long) i * dims + d);
+                } else if(gb->layout == GB_LAYOUT_AOSOA) {
+                    store(gb, AOSOA_IDX(i, d, block, dims), (long) i * dims + d);
+                } else {
+                    store(gb, (long) N * d + i, (long) N * d + i);
+                }
+            }
+        }
+    }
+
+    switch(gb->layout) {
+        case GB_LAYOUT_AOS:     gb->layout_arg = width; break;
+        case GB_LAYOUT_AOSOA:   gb->layout_arg = AOSOA_ARG(block, dims); break;
+        // SoA component arrays are N elements long
+        default:                gb->layout_arg = N; break;
+    }
+
+    if(gb->kernel == GB_KERNEL_MD) {
+        gb->f = (double*) reserve(gb->f, &gb->f_capacity, N_alloc * dims * sizeof(double));
+        for(int i = 0; i < N_alloc * dims; ++i) {
+            gb->f[i] = 0.0;
+        }
+
+        gb->its = 0.0;
+        gb->elems = 0;
+        for(int i = 0; i < gb->nlocal; i++) {
+            gb->its += (gb->numneighs[i] / _VL_) + ((gb->numneighs[i] % _VL_ == 0) ? 0 : 1);
+            gb->elems += gb->numneighs[i];
+        }
+
+        // Kernels may store full vectors past the last neighbor of a component
+        gb->ntest = gb->elems + _VL_;
+        gb->cache_lines_per_gather = gatherbench_cache_lines_per_gather(gb);
+        gb->cut_cl = 0;
+#ifdef TEST
+        gb->t = (double*) reserve(gb->t, &gb->t_capacity, gb->ntest * dims * sizeof(double));
+#endif
+        count_touched(gb);
+        return 1;
+    }
+
+    gb->idx = (int*) reserve(gb->idx, &gb->idx_capacity, N_alloc * sizeof(int));
+    if(gb->index == GB_INDEX_ZIPF) {
+        srand48(N);
+        for(int i = 0; i < N_alloc; ++i) {
+            gb->idx[i] = gatherbench_zipf_index(N, gb->zipf);
+        }
+    } else if(gb->index == GB_INDEX_USER) {
+        // Kernels may read past N, repeat the given indices
+        for(int i = 0; i < N_alloc; ++i) {
+            gb->idx[i] = gb->user_idx[i % N];
+        }
+    } else {
+        for(int i = 0; i < N_alloc; ++i) {
+            gb->idx[i] = (int)(((long) i * gb->stride) % N);
+        }
+    }
+
+    gb->its = (N / _VL_) + ((N % _VL_ == 0) ? 0 : 1);
+    gb->elems = N;
+    gb->ntest = N;
+#ifdef TEST
+    gb->t = (double*) reserve(gb->t, &gb->t_capacity, N_alloc * dims * sizeof(double));
+#endif
+
+    gb->cache_lines_per_gather = gatherbench_cache_lines_per_gather(gb);
+    gb->cut_cl = 0;
+    if(gb->kernel != GB_KERNEL_GATHER && gb->layout == GB_LAYOUT_AOS) {
+        const int cl_shift = log2_uint((unsigned int) gb->cl_size);
+        for(int i = 0; i < N; i++) {
+            const int first_cl = (gb->idx[i] * width * esize) >> cl_shift;
+            const int last_cl = ((gb->idx[i] * width + gb->gathered_dims - 1) * esize) >> cl_shift;
+            if(first_cl != last_cl) {
+                gb->cut_cl++;
+            }
+        }
+    }
+
+    count_touched(gb);
+    return 1;
+}
+
+// One pass over all neighbor lists, loading the position of each atom
+// before gathering its neighbors
+static void md_pass(gatherbench_t* gb) {
+#ifndef ISA_sve
+    double* a = gb->a;
+    int t_idx = 0;
+
+    for(int i = 0; i < gb->nlocal; i++) {
+        int* neighbors = (int*) &gb->neighborlists[i * gb->maxneighs];
+        double* t = (gb->t != NULL) ? &gb->t[t_idx] : NULL;
+
+        if(gb->layout == GB_LAYOUT_AOSOA) {
+            load_aosoa(&a[AOSOA_IDX(i, 0, gb->block, gb->dims)], gb->block);
+            t_idx += gather_md_aosoa(a, neighbors, gb->numneighs[i], t, gb->ntest, gb->block);
+        } else {
+#ifdef ISA_avx512
+            load_aos(&a[i * gb->width]);
+            t_idx += gather_md_aos(a, neighbors, gb->numneighs[i], t, gb->ntest);
+#endif
+        }
+
+        gb->f[i * 3 + 0] += i;
+        gb->f[i * 3 + 1] += i;
+        gb->f[i * 3 + 2] += i;
+    }
+#endif
+}
+
+static void widen_pass(gatherbench_t* gb) {
+    const int k = gb->gathered_dims - 1;
+    const int aos = (gb->layout == GB_LAYOUT_AOS);
+    gather_widen_dims_t kernel;
+
+    switch(gb->precision) {
+        case GB_FLOAT:      kernel = aos ? gather_aos_f32_dims[k] : gather_soa_f32_dims[k]; break;
+        case GB_HALF:       kernel = aos ? gather_aos_f16_dims[k] : gather_soa_f16_dims[k]; break;
+        default:            kernel = aos ? gather_aos_bf16_dims[k] : gather_soa_bf16_dims[k]; break;
+    }
+
+    kernel(gb->a, gb->idx, gb->N, gb->t, gb->layout_arg);
+}
+
+static void pass(gatherbench_t* gb) {
+    switch(gb->kernel) {
+        case GB_KERNEL_GATHER:
+            gather(gb->a, gb->idx, gb->N, gb->t);
+            break;
+
+        case GB_KERNEL_DIMS:
+            if(gb->generated) {
+                gather_kernel_lookup(gb->layout, gb->precision, gb->gathered_dims, gb->unroll)(gb->a, gb->idx, gb->N, gb->t, gb->layout_arg);
+            } else if(gb->precision != GB_DOUBLE) {
+                widen_pass(gb);
+            } else if(gb->layout == GB_LAYOUT_AOS) {
+                gather_aos_dims[gb->gathered_dims - 1](gb->a, gb->idx, gb->N, gb->t, gb->layout_arg);
+            } else if(gb->layout == GB_LAYOUT_AOSOA) {
+                gather_aosoa_dims[gb->gathered_dims - 1](gb->a, gb->idx, gb->N, gb->t, gb->layout_arg);
+            } else {
+                gather_soa_dims[gb->gathered_dims - 1](gb->a, gb->idx, gb->N, gb->t, gb->layout_arg);
+            }
+            break;
+
+        case GB_KERNEL_COALESCE:
+#ifndef ISA_sve
+            gather_aos_coalesce_dims[gb->gathered_dims - 1](gb->a, gb->idx, gb->N, gb->t, gb->layout_arg);
+#endif
+            break;
+
+        case GB_KERNEL_MD:
+            md_pass(gb);
+            break;
+    }
+}
+
+double gatherbench_time(gatherbench_t* gb, int reps) {
+    double E, S;
+
+    S = getTimeStamp();
+    LIKWID_MARKER_START("gather");
+    for(int r = 0; r < reps; ++r) {
+        pass(gb);
+    }
+    LIKWID_MARKER_STOP("gather");
+    E = getTimeStamp();
+
+    return E - S;
+}
+
+int gatherbench_check(gatherbench_t* gb) {
+#ifdef TEST
+    const long ntest = gb->ntest;
+    const int dims = gb->dims;
+
+    if(gb->kernel == GB_KERNEL_MD) {
+        long t_idx = 0;
+        for(int i = 0; i < gb->nlocal; ++i) {
+            const int* neighbors = &gb->neighborlists[i * gb->maxneighs];
+            for(int j = 0; j < gb->numneighs[i]; ++j) {
+                const int k = neighbors[j];
+                for(int d = 0; d < dims; ++d) {
+                    if(gb->t[d * ntest + t_idx] != k * dims + d) {
+                        return 0;
+                    }
+                }
+
+                t_idx++;
+            }
+        }
+
+        return 1;
+    }
+
+    for(int i = 0; i < gb->N; ++i) {
+        for(int d = 0; d < gb->gathered_dims; ++d) {
+            double expected;
+            if(gb->kernel == GB_KERNEL_GATHER) {
+                expected = gb->idx[i];
+            } else if(gb->layout == GB_LAYOUT_SOA) {
+                expected = d * gb->N + gb->idx[i];
+            } else {
+                expected = gb->idx[i] * dims + d;
+            }
+
+            if(gb->t[d * ntest + i] != (double)((long) expected % value_range(gb->precision))) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+#else
+    (void) gb;
+    return -1;
+#endif
+}
+
+int gatherbench_run(gatherbench_t* gb, gatherbench_result_t* result) {
+    const char* reason = unsupported(gb);
+    double E, S;
+
+    if(reason != NULL || gb->a == NULL) {
+        fprintf(stderr, "gatherbench: %s %s kernel: %s!\n", gatherbench_layout_name(gb->layout), gatherbench_kernel_name(gb->kernel), (reason != NULL) ? reason : "not initialized");
+        return 0;
+    }
+
+    S = getTimeStamp();
+    for(int r = 0; r < 100; ++r) {
+        pass(gb);
+    }
+    E = getTimeStamp();
+
+    const int rep = MAX((int)(100 * (0.5 / (E - S))), 1);
+    const double time = gatherbench_time(gb, rep);
+    const double freq = gb->freq * 1e9;
+    const double elems = (double) gb->elems * rep;
+
+    result->time = time;
+    result->reps = rep;
+    result->time_per_lup = time * 1e6 / elems;
+    result->cy_per_it = time * freq / (gb->its * rep);
+    result->cy_per_gather = result->cy_per_it / gb->gathered_dims;
+    result->cy_per_elem = time * freq / (elems * gb->gathered_dims);
+    result->useful_gbs = elems * gb->gathered_dims * gb->esize / time * 1e-9;
+    result->transferred_gbs = (double) gb->lines * gb->cl_size * rep / time * 1e-9;
+    result->line_utilization = (double) gb->words * gb->esize / ((double) gb->lines * gb->cl_size);
+    result->test = gatherbench_check(gb);
+    result->cold_min = result->cold_med = result->cold_max = 0.0;
+
+    if(gb->cold) {
+        // Cold reps cannot be amortized, each one is timed on its own
+        double cold_times[COLD_REPS];
+        void* idx = (gb->kernel == GB_KERNEL_MD) ? (void*) gb->neighborlists : (void*) gb->idx;
+        size_t idx_bytes = ((gb->kernel == GB_KERNEL_MD) ? (size_t) gb->nlocal * gb->maxneighs : (size_t) gb->N) * sizeof(int);
+
+        for(int r = 0; r < COLD_REPS; ++r) {
+            prepare_cache(gb->a, gb->a_bytes, idx, idx_bytes);
+            S = getTimeStamp();
+            pass(gb);
+            E = getTimeStamp();
+            cold_times[r] = E - S;
+        }
+
+        const double cold_scale = freq / ((double) gb->elems * gb->gathered_dims);
+        cold_summary(cold_times, COLD_REPS, &result->cold_min, &result->cold_med, &result->cold_max);
+        result->cold_min *= cold_scale;
+        result->cold_med *= cold_scale;
+        result->cold_max *= cold_scale;
+    }
+
+    return 1;
+}
@@ -0,0 +1,133 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+//---
+#include <allocate.h>
+#include <hash_table.h>
+
+#define ARRAY_ALIGNMENT  64
+// Smallest table, the gather kernels shift by at most 32 - 4 bits
+#define MIN_CAPACITY  16
+
+int hash_table_build(hash_table_t* t, const int* keys, const int* vals, int n) {
+    if(t->load <= 0.0 || (t->kind == HASH_OPEN && t->load >= 1.0)) {
+        fprintf(stderr, "Load factor must be positive and below 1 for open addressing!\n");
+        return 0;
+    }
+
+    int log2_capacity = 4;
+    while((1L << log2_capacity) < MIN_CAPACITY || (1L << log2_capacity) * t->load < n) {
+        log2_capacity++;
+    }
+
+    if(log2_capacity > 30) {
+        fprintf(stderr, "Hash table too large!\n");
+        return 0;
+    }
+
+    hash_table_free(t);
+    t->n = n;
+    t->capacity = 1 << log2_capacity;
+    t->shift = 32 - log2_capacity;
+
+    if(t->kind == HASH_OPEN) {
+        t->keys = (int*) allocate( ARRAY_ALIGNMENT, t->capacity * sizeof(int) );
+        t->vals = (int*) allocate( ARRAY_ALIGNMENT, t->capacity * sizeof(int) );
+        for(int s = 0; s < t->capacity; s++) {
+            t->keys[s] = HASH_EMPTY;
+            t->vals[s] = HASH_EMPTY;
+        }
+
+        for(int i = 0; i < n; i++) {
+            int s = HASH(keys[i], t->shift);
+            while(t->keys[s] != HASH_EMPTY) {
+                s = (s + 1) & (t->capacity - 1);
+            }
+
+            t->keys[s] = keys[i];
+            t->vals[s] = vals[i];
+        }
+    } else {
+        t->head = (int*) allocate( ARRAY_ALIGNMENT, t->capacity * sizeof(int) );
+        t->nodes = (hash_node_t*) allocate( ARRAY_ALIGNMENT, (n > 0 ? n : 1) * sizeof(hash_node_t) );
+        for(int b = 0; b < t->capacity; b++) {
+            t->head[b] = HASH_EMPTY;
+        }
+
+        for(int i = 0; i < n; i++) {
+            const int b = HASH(keys[i], t->shift);
+            t->nodes[i] = (hash_node_t) { keys[i], vals[i], t->head[b], 0 };
+            t->head[b] = i;
+        }
+    }
+
+    return 1;
+}
+
+// Scalar reference, out[i] is the value of probe[i] or HASH_EMPTY
+void hash_table_probe(const hash_table_t* t, const int* probe, int n, int* out) {
+    if(t->kind == HASH_OPEN) {
+        const int mask = t->capacity - 1;
+        for(int i = 0; i < n; i++) {
+            int s = HASH(probe[i], t->shift);
+            while(t->keys[s] != probe[i] && t->keys[s] != HASH_EMPTY) {
+                s = (s + 1) & mask;
+            }
+
+            out[i] = t->vals[s];
+        }
+    } else {
+        for(int i = 0; i < n; i++) {
+            int k = t->head[HASH(probe[i], t->shift)];
+            while(k != HASH_EMPTY && t->nodes[k].key != probe[i]) {
+                k = t->nodes[k].next;
+            }
+
+            out[i] = (k != HASH_EMPTY) ? t->nodes[k].val : HASH_EMPTY;
+        }
+    }
+}
+
+size_t hash_table_bytes(const hash_table_t* t) {
+    if(t->kind == HASH_OPEN) {
+        return (size_t) t->capacity * 2 * sizeof(int);
+    }
+
+    return (size_t) t->capacity * sizeof(int) + (size_t) t->n * sizeof(hash_node_t);
+}
+
+void hash_table_free(hash_table_t* t) {
+    free(t->keys);
+    free(t->vals);
+    free(t->head);
+    free(t->nodes);
+    t->keys = NULL;
+    t->vals = NULL;
+    t->head = NULL;
+    t->nodes = NULL;
+}
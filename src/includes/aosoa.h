@@ -0,0 +1,40 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifndef __AOSOA_H_
+#define __AOSOA_H_
+
+// Index of component d of element i in AoSoA layout with blocks of b elements
+#define AOSOA_IDX(i, d, b, dims) (((i) / (b)) * (b) * (dims) + (d) * (b) + (i) % (b))
+
+// Layout argument of the AoSoA dims kernels, the block size (power of two
+// up to AOSOA_MAX_BLOCK) in the low 16 bits and the components per element above
+#define AOSOA_MAX_BLOCK  32768
+#define AOSOA_ARG(b, dims) (((dims) << 16) | (b))
+#define AOSOA_ARG_BLOCK(arg) ((arg) & 0xffff)
+#define AOSOA_ARG_DIMS(arg) ((arg) >> 16)
+
+#endif
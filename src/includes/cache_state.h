@@ -0,0 +1,53 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifndef __CACHE_STATE_H_
+#define __CACHE_STATE_H_
+
+#include <stddef.h>
+
+#if defined(CACHE_FLUSH) || defined(CACHE_EVICT) || defined(CACHE_IDX_ONLY)
+#define CACHE_COLD
+#endif
+
+#if defined(CACHE_FLUSH)
+#define CACHE_STATE_STRING "flush"
+#elif defined(CACHE_EVICT)
+#define CACHE_STATE_STRING "evict"
+#elif defined(CACHE_IDX_ONLY)
+#define CACHE_STATE_STRING "idx only"
+#else
+#define CACHE_STATE_STRING "warm"
+#endif
+
+// Individually timed cold reps per row
+#define COLD_REPS  11
+
+extern void flush_lines(void* ptr, size_t bytes);
+extern void prepare_cache(void* a, size_t a_bytes, void* idx, size_t idx_bytes);
+extern void cold_summary(double* times, int n, double* min, double* med, double* max);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifndef __GATHER_KERNELS_H_
+#define __GATHER_KERNELS_H_
+
+#include <gatherbench.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Kernels generated from the C++ templates in gather_kernels.cc, with the
+// interface of the hand-written gather_<layout>_dims kernels: D components
+// of N elements are gathered from a, written to t[d * N + i] with TEST.
+// layout_arg is the struct width (AoS), AOSOA_ARG(block, dims) (AoSoA) or
+// component array length (SoA) in elements.
+typedef void (*gather_kernel_t)(void* a, int* idx, int N, double* t, int layout_arg);
+
+// Index vectors per loop iteration the kernels are generated for
+#define GATHER_KERNEL_UNROLLS  3
+extern const int gather_kernel_unrolls[GATHER_KERNEL_UNROLLS];
+
+// Kernel for double or float elements, 1 <= dims <= 16 and an unroll of
+// gather_kernel_unrolls, NULL for other combinations
+extern gather_kernel_t gather_kernel_lookup(gb_layout_t layout, gb_precision_t precision, int dims, int unroll);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
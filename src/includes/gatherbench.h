@@ -0,0 +1,149 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifndef __GATHERBENCH_H_
+#define __GATHERBENCH_H_
+
+#include <stddef.h>
+
+// Kernels of libgatherbench. GATHER is the single array gather of main.c,
+// DIMS the layout kernels of main-md.c, COALESCE the AoS kernels gathering
+// repeated indices once (not on sve) and MD the neighbor list kernels of
+// main-md-trace.c (AoS on avx512, AoSoA on avx2 and avx512)
+typedef enum {
+    GB_KERNEL_GATHER = 0,
+    GB_KERNEL_DIMS,
+    GB_KERNEL_COALESCE,
+    GB_KERNEL_MD
+} gb_kernel_t;
+
+typedef enum {
+    GB_LAYOUT_AOS = 0,
+    GB_LAYOUT_SOA,
+    GB_LAYOUT_AOSOA
+} gb_layout_t;
+
+// Where the gathered indices come from, NEIGHBORS is required by (and only
+// valid for) the MD kernel
+typedef enum {
+    GB_INDEX_STRIDE = 0,
+    GB_INDEX_ZIPF,
+    GB_INDEX_USER,
+    GB_INDEX_NEIGHBORS
+} gb_index_t;
+
+// Storage format of a, gathered values are always widened to double. The
+// reduced formats are available for the DIMS kernel in AoS and SoA layouts
+typedef enum {
+    GB_DOUBLE = 0,
+    GB_FLOAT,
+    GB_HALF,
+    GB_BFLOAT16
+} gb_precision_t;
+
+// One benchmark configuration and the data it runs on. Zero the struct, set
+// the parameters and call gatherbench_init, which may be called again after
+// changing them. Zero parameters select the defaults given below.
+typedef struct {
+    // Parameters
+    gb_kernel_t kernel;
+    gb_layout_t layout;
+    gb_index_t index;
+    gb_precision_t precision;
+    int N;                      // gathered elements, atoms (local + ghost) for MD
+    int stride;                 // STRIDE: idx[i] = i * stride % N (default 1)
+    double zipf;                // ZIPF: exponent of the index distribution
+    const int* user_idx;        // USER: N indices in [0, N), N a multiple of the vector
+                                // width for kernels without a masked tail
+    int nlocal;                 // NEIGHBORS: lists of atom i are
+    int maxneighs;              // neighborlists[i * maxneighs + k] for
+    const int* neighborlists;   // k < numneighs[i], i < nlocal
+    const int* numneighs;
+    int dims;                   // components per element (default 1 for GATHER, 3 otherwise)
+    int gathered_dims;          // components gathered per element (default dims)
+    int width;                  // components per struct in AoS layout (default dims)
+    int block;                  // elements per AoSoA block, power of two (default vector width)
+    int cl_size;                // cache line size in bytes (default 64)
+    double freq;                // GHz (default 2.5)
+    int cold;                   // also time cold reps after prepare_cache
+    int generated;              // DIMS: run the C++ intrinsics kernels instead of the assembly
+    int unroll;                 // index vectors per iteration of the generated kernels (default 1)
+    // State
+    int N_alloc;
+    size_t a_capacity;          // allocated bytes, kept across inits
+    size_t idx_capacity;
+    size_t t_capacity;
+    size_t f_capacity;
+    void* a;                    // elements of precision
+    size_t a_bytes;             // bytes of a touched by the kernels
+    int esize;                  // bytes per component of a
+    int* idx;
+    double* t;                  // gathered values, only written with TEST
+    double* f;                  // MD forces
+    long ntest;
+    int layout_arg;
+    double its;                 // vector iterations per pass
+    long elems;                 // gathered elements per pass
+    size_t cache_lines_per_gather;
+    int cut_cl;                 // AoS elements spanning two cache lines
+    long words;                 // distinct components of a touched per pass
+    long lines;                 // distinct cache lines of a touched per pass
+    long pages;                 // distinct 4 KiB pages of a touched per pass
+} gatherbench_t;
+
+typedef struct {
+    double time;                // seconds for reps passes
+    int reps;
+    double time_per_lup;        // us per gathered element
+    double cy_per_it;
+    double cy_per_gather;
+    double cy_per_elem;
+    double useful_gbs;          // esize B per gathered component
+    double transferred_gbs;     // whole cache lines touched
+    double line_utilization;    // distinct gathered / transferred bytes
+    double cold_min;            // cy/elem of single cold passes, with cold
+    double cold_med;
+    double cold_max;
+    int test;                   // 1 passed, 0 failed, -1 not built with TEST
+} gatherbench_result_t;
+
+extern const char* gatherbench_isa();
+extern int gatherbench_vector_width();
+extern const char* gatherbench_kernel_name(gb_kernel_t kernel);
+extern const char* gatherbench_layout_name(gb_layout_t layout);
+extern const char* gatherbench_precision_name(gb_precision_t precision);
+extern int gatherbench_supported(const gatherbench_t* gb);
+extern size_t gatherbench_cache_lines_per_gather(const gatherbench_t* gb);
+// Index in [0, n) drawn with drand48 from a continuous approximation of a
+// Zipf distribution with exponent s (uniform for s = 0)
+extern int gatherbench_zipf_index(int n, double s);
+extern int gatherbench_init(gatherbench_t* gb);
+extern double gatherbench_time(gatherbench_t* gb, int reps);
+extern int gatherbench_check(gatherbench_t* gb);
+extern int gatherbench_run(gatherbench_t* gb, gatherbench_result_t* result);
+extern void gatherbench_free(gatherbench_t* gb);
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifndef __HASH_TABLE_H_
+#define __HASH_TABLE_H_
+
+#include <stdint.h>
+
+#define HASH_MULTIPLIER  0x9E3779B1u
+#define HASH_EMPTY  (-1)
+
+// Multiplicative hash to the upper 32 - shift bits
+#define HASH(key, shift) ((int)(((uint32_t)(key) * HASH_MULTIPLIER) >> (shift)))
+
+// Node of a bucket-chained table, next is the index of the following node
+// of the bucket or HASH_EMPTY
+typedef struct {
+    int key;
+    int val;
+    int next;
+    int pad;
+} hash_node_t;
+
+// Hash table with non-negative int keys and int values. OPEN uses linear
+// probing in keys/vals with capacity slots, CHAINED heads of capacity
+// buckets pointing into nodes. The capacity is a power of two >= n / load.
+typedef enum {
+    HASH_OPEN = 0,
+    HASH_CHAINED
+} hash_kind_t;
+
+typedef struct {
+    // Parameters
+    hash_kind_t kind;
+    double load;        // keys per slot (OPEN, below 1) or per bucket
+    // State
+    int n;
+    int capacity;
+    int shift;          // 32 - log2(capacity)
+    int* keys;          // OPEN
+    int* vals;
+    int* head;          // CHAINED
+    hash_node_t* nodes;
+} hash_table_t;
+
+extern int hash_table_build(hash_table_t* t, const int* keys, const int* vals, int n);
+extern void hash_table_probe(const hash_table_t* t, const int* probe, int n, int* out);
+extern size_t hash_table_bytes(const hash_table_t* t);
+extern void hash_table_free(hash_table_t* t);
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifndef __INTERFERENCE_H_
+#define __INTERFERENCE_H_
+
+#ifndef BG_THREADS
+#define BG_THREADS  2
+#endif
+
+#if defined(BG_COPY)
+#define BG_KERNEL_STRING "copy"
+#elif defined(BG_RANDOM)
+#define BG_KERNEL_STRING "random"
+#else
+#define BG_KERNEL_STRING "triad"
+#endif
+
+#ifdef BG_SMT_GATHER
+#define BG_SMT_STRING "yes"
+#else
+#define BG_SMT_STRING "no"
+#endif
+
+// Pins the calling thread to the first CPU it is allowed to run on
+extern void interference_init();
+// Starts the background threads, returns once all of them are running
+extern void interference_start(double* a, int* idx, int N);
+// Stops the background threads, returns the bandwidth they achieved in GB/s
+extern double interference_stop();
+// Frees the arrays of the background threads
+extern void interference_free();
+
+#endif
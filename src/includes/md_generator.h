@@ -0,0 +1,63 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifndef __MD_GENERATOR_H_
+#define __MD_GENERATOR_H_
+
+// Synthetic MD system with periodic boundaries whose neighbor lists have the
+// same layout as the ones parsed from MD-Bench traces: neighbors of local
+// atom i are neighborlists[i * maxneighs + k] for k < numneighs[i], indices
+// >= nlocal refer to ghost atoms
+typedef struct {
+    // Parameters
+    int fcc;            // FCC lattice, otherwise uniformly random positions
+    int natoms;         // requested atoms (rounded to full unit cells for FCC)
+    double density;     // atoms per unit volume
+    double cutoff;
+    double skin;
+    double perturb;     // maximum displacement per coordinate and timestep
+    int half;           // half lists (j > i) instead of full lists
+    // State
+    double box;
+    int nlocal;
+    int nghost;
+    int nmax;
+    double* x;          // positions of local and ghost atoms, 3 per atom
+    int maxneighs;
+    long nneighs;       // total neighbors in the last build
+    int* neighborlists;
+    int* numneighs;
+    int nbins;
+    int* bins;
+    int* next;
+} md_generator_t;
+
+extern int md_generator_init(md_generator_t* gen);
+extern void md_generator_step(md_generator_t* gen);
+extern void md_generator_build(md_generator_t* gen);
+extern void md_generator_free(md_generator_t* gen);
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifndef __NEIGHBOR_ORDER_H_
+#define __NEIGHBOR_ORDER_H_
+
+#include <gatherbench.h>
+
+// Preprocessing applied to the neighbor lists at every reneighboring step:
+// INDEX sorts each list by atom index, CACHELINE groups the neighbors of a
+// list by the cache line holding their first component (keeping the trace
+// order within a line) and CLUSTER replaces the lists by cluster pairs: the
+// local atoms are split into clusters of consecutive atoms and every atom
+// of a cluster gathers all atoms of each cluster holding a neighbor of any
+// of its atoms
+typedef enum {
+    NEIGHBOR_ORDER_NONE = 0,
+    NEIGHBOR_ORDER_INDEX,
+    NEIGHBOR_ORDER_CACHELINE,
+    NEIGHBOR_ORDER_CLUSTER
+} neighbor_order_mode_t;
+
+typedef struct {
+    // Parameters
+    neighbor_order_mode_t mode;
+    int cluster;                // atoms per cluster for CLUSTER
+    gb_layout_t layout;         // layout of the gathered array for CACHELINE
+    int width;
+    int block;
+    int dims;
+    int cl_size;
+    // State, lists in the layout of the input lists
+    int maxneighs;
+    int* neighborlists;
+    int* numneighs;
+    size_t capacity;            // ints allocated for neighborlists
+    int nlocal_alloc;
+    long nneighs;               // total neighbors after preprocessing
+} neighbor_order_t;
+
+extern int neighbor_order_parse(const char* name, neighbor_order_mode_t* mode);
+extern const char* neighbor_order_name(neighbor_order_mode_t mode);
+extern void neighbor_order_apply(neighbor_order_t* ord, int nlocal, int nall, int maxneighs, const int* neighborlists, const int* numneighs);
+extern void neighbor_order_free(neighbor_order_t* ord);
+
+#endif
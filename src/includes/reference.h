@@ -0,0 +1,40 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifndef __REFERENCE_H_
+#define __REFERENCE_H_
+
+// Scalar reference kernels of the drivers. They live in a regular object
+// so they are built with CFLAGS like the rest of the benchmark.
+
+// y = A * x for a CSR matrix with nrows rows
+extern void spmv_csr_scalar(int nrows, const int* rowptr, const int* col, const double* val, const double* x, double* y);
+// y[i] = sum of x[col[j]] over row i, the CSR product without weights
+extern void pull_sum_scalar(int nrows, const int* rowptr, const int* col, const double* x, double* y);
+// out[b] = sum of the table rows idx[b * bag + j] for j < bag, rows of D floats
+extern void embedding_scalar(const float* table, int D, const int* idx, int nbags, int bag, float* out);
+
+#endif
@@ -31,4 +31,8 @@ extern double getTimeStamp();
 extern double getTimeResolution();
 extern double getTimeStamp_();
 
+// Calibrates the reps from 10 warm runs of kernel(arg) to about 0.5 s, then
+// times *rep runs inside the LIKWID region and returns their total time
+extern double measureReps(void (*kernel)(void*), void* arg, const char* region, int* rep);
+
 #endif
@@ -0,0 +1,350 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#ifdef INTERFERENCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+//---
+#include <allocate.h>
+#include <timing.h>
+#include <interference.h>
+
+// Size of each background array in MB, must exceed the LLC share of each thread
+#ifndef BG_MB
+#define BG_MB  64
+#endif
+
+#define BG_SIZE  ((size_t) BG_MB * 1024 * 1024 / sizeof(double))
+
+#ifdef TEST
+extern void gather(double*, int*, int, double*);
+#else
+extern void gather(double*, int*, int);
+#endif
+
+typedef struct {
+    int cpu;
+    double* a;
+    double* b;
+    double* c;
+    double bytes;
+    double time;
+    pthread_t thread;
+} bg_thread_t;
+
+static bg_thread_t bg[BG_THREADS];
+static pthread_barrier_t bg_barrier;
+static volatile int bg_stop;
+static int main_cpu = -1;
+
+#ifdef BG_SMT_GATHER
+static int smt_cpu = -1;
+static pthread_t smt_thread;
+static double* smt_a;
+static int* smt_idx;
+static int smt_N;
+#endif
+
+static void pin_thread(pthread_t thread, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if(pthread_setaffinity_np(thread, sizeof(cpu_set_t), &set) != 0) {
+        fprintf(stderr, "Warning: could not pin thread to CPU %d\n", cpu);
+    }
+}
+
+// Threads are created pinned so their first touch already happens on cpu
+static void create_pinned(pthread_t* thread, int cpu, void* (*func)(void*), void* arg)
+{
+    pthread_attr_t attr;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &set);
+    if(pthread_create(thread, &attr, func, arg) != 0) {
+        fprintf(stderr, "Error: could not create background thread on CPU %d\n", cpu);
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+// First hardware thread sharing a core with cpu, -1 if there is none
+static int smt_sibling(int cpu)
+{
+    char path[128];
+    int sibling = -1;
+    snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+
+    FILE* fp = fopen(path, "r");
+    if(fp == NULL) {
+        return -1;
+    }
+
+    int first, last;
+    char sep;
+    while(fscanf(fp, "%d", &first) == 1) {
+        last = first;
+        if(fscanf(fp, "%c", &sep) == 1 && sep == '-') {
+            if(fscanf(fp, "%d", &last) != 1) {
+                break;
+            }
+
+            if(fscanf(fp, "%c", &sep) != 1) {
+                sep = '\n';
+            }
+        }
+
+        for(int c = first; c <= last && sibling < 0; c++) {
+            if(c != cpu) {
+                sibling = c;
+            }
+        }
+
+        if(sep != ',') {
+            break;
+        }
+    }
+
+    fclose(fp);
+    return sibling;
+}
+
+static void* bg_run(void* arg)
+{
+    bg_thread_t* th = (bg_thread_t*) arg;
+    const size_t n = BG_SIZE;
+    double E, S;
+
+    // First touch by the pinned thread places the arrays in its NUMA domain
+    if(th->a == NULL) {
+        th->a = (double*) allocate(64, n * sizeof(double));
+        th->b = (double*) allocate(64, n * sizeof(double));
+        th->c = (double*) allocate(64, n * sizeof(double));
+        for(size_t i = 0; i < n; i++) {
+            th->a[i] = 1.0;
+            th->b[i] = 2.0;
+            th->c[i] = 0.0;
+        }
+    }
+
+    double* restrict a = th->a;
+    double* restrict b = th->b;
+    double* restrict c = th->c;
+    double bytes = 0.0;
+    // Not every background kernel uses all three arrays
+    (void) b;
+    (void) c;
+#ifdef BG_RANDOM
+    unsigned long x = 88172645463325252UL + th->cpu;
+#endif
+
+    pthread_barrier_wait(&bg_barrier);
+    S = getTimeStamp();
+
+    while(!bg_stop) {
+#if defined(BG_COPY)
+        for(size_t i = 0; i < n; i++) {
+            c[i] = a[i];
+        }
+
+        bytes += 2.0 * sizeof(double) * n;
+#elif defined(BG_RANDOM)
+        // Read-modify-write of random elements, counted as one cache line read and written
+        for(size_t i = 0; i < n / 8; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            a[x % n] += 1.0;
+        }
+
+        bytes += 2.0 * 64 * (n / 8);
+#else
+        for(size_t i = 0; i < n; i++) {
+            a[i] = b[i] + 3.0 * c[i];
+        }
+
+        bytes += 3.0 * sizeof(double) * n;
+#endif
+    }
+
+    E = getTimeStamp();
+    th->bytes = bytes;
+    th->time = E - S;
+    return NULL;
+}
+
+#ifdef BG_SMT_GATHER
+// Second gather stream on the SMT sibling of the measuring thread, on its
+// own copies of the arrays so it competes for the shared caches
+static void* smt_run(void* arg)
+{
+    (void) arg;
+    double* a = (double*) allocate(64, smt_N * sizeof(double));
+    int* idx = (int*) allocate(64, smt_N * sizeof(int));
+    for(int i = 0; i < smt_N; i++) {
+        a[i] = smt_a[i];
+        idx[i] = smt_idx[i];
+    }
+#ifdef TEST
+    double* t = (double*) allocate(64, smt_N * sizeof(double));
+#endif
+
+    pthread_barrier_wait(&bg_barrier);
+
+    while(!bg_stop) {
+#ifdef TEST
+        gather(a, idx, smt_N, t);
+#else
+        gather(a, idx, smt_N);
+#endif
+    }
+
+#ifdef TEST
+    free(t);
+#endif
+    free(a);
+    free(idx);
+    return NULL;
+}
+#endif
+
+void interference_init()
+{
+    cpu_set_t set;
+    const int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+    for(int c = 0; c < ncpus && main_cpu < 0; c++) {
+        if(CPU_ISSET(c, &set)) {
+            main_cpu = c;
+        }
+    }
+
+    pin_thread(pthread_self(), main_cpu);
+    const int sibling = smt_sibling(main_cpu);
+
+#ifdef BG_SMT_GATHER
+    smt_cpu = sibling;
+    if(smt_cpu < 0) {
+        fprintf(stderr, "Warning: CPU %d has no SMT sibling, running without second gather stream\n", main_cpu);
+    }
+#endif
+
+    // Background threads go round-robin to the allowed CPUs outside the measuring core
+    int cpus[CPU_SETSIZE];
+    int nbg = 0;
+    for(int c = 0; c < ncpus; c++) {
+        if(CPU_ISSET(c, &set) && c != main_cpu && c != sibling) {
+            cpus[nbg++] = c;
+        }
+    }
+
+    if(nbg < BG_THREADS) {
+        fprintf(stderr, "Warning: only %d CPUs left for %d background threads, oversubscribing\n", nbg, BG_THREADS);
+    }
+
+    if(nbg == 0) {
+        cpus[nbg++] = main_cpu;
+    }
+
+    for(int t = 0; t < BG_THREADS; t++) {
+        bg[t].cpu = cpus[t % nbg];
+        bg[t].a = NULL;
+    }
+}
+
+void interference_start(double* a, int* idx, int N)
+{
+    int nthreads = BG_THREADS + 1;
+
+#ifdef BG_SMT_GATHER
+    smt_a = a;
+    smt_idx = idx;
+    smt_N = N;
+    nthreads += (smt_cpu >= 0);
+#else
+    (void) a;
+    (void) idx;
+    (void) N;
+#endif
+
+    bg_stop = 0;
+    pthread_barrier_init(&bg_barrier, NULL, nthreads);
+
+    for(int t = 0; t < BG_THREADS; t++) {
+        create_pinned(&bg[t].thread, bg[t].cpu, bg_run, &bg[t]);
+    }
+
+#ifdef BG_SMT_GATHER
+    if(smt_cpu >= 0) {
+        create_pinned(&smt_thread, smt_cpu, smt_run, NULL);
+    }
+#endif
+
+    pthread_barrier_wait(&bg_barrier);
+}
+
+double interference_stop()
+{
+    double bw = 0.0;
+
+    bg_stop = 1;
+    for(int t = 0; t < BG_THREADS; t++) {
+        pthread_join(bg[t].thread, NULL);
+        bw += bg[t].bytes / bg[t].time;
+    }
+
+#ifdef BG_SMT_GATHER
+    if(smt_cpu >= 0) {
+        pthread_join(smt_thread, NULL);
+    }
+#endif
+
+    pthread_barrier_destroy(&bg_barrier);
+    return bw * 1e-9;
+}
+
+void interference_free()
+{
+    for(int t = 0; t < BG_THREADS; t++) {
+        free(bg[t].a);
+        free(bg[t].b);
+        free(bg[t].c);
+        bg[t].a = NULL;
+        bg[t].b = NULL;
+        bg[t].c = NULL;
+    }
+}
+#endif
@@ -0,0 +1,261 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+//---
+#include <likwid-marker.h>
+//---
+#include <allocate.h>
+#include <gatherbench.h>
+#include <reference.h>
+#include <timing.h>
+
+#if !defined(ISA_avx2) && !defined (ISA_avx512)
+#error "Invalid ISA macro, the embedding kernels are available for: avx2 and avx512"
+#endif
+
+#ifndef MIN
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#endif
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+
+#define ARRAY_ALIGNMENT  64
+#define NKERNELS  4
+#define MAX_BAG  1024
+#define MAX_DISTANCE  256
+
+#if defined(ISA_avx512)
+#define ISA_STRING "avx512"
+#define _VL_ 16
+#else
+#define ISA_STRING "avx2"
+#define _VL_ 8
+#endif
+
+extern void embedding_rows(const float* table, int D, const int* idx, int nbags, int bag, float* out);
+extern void embedding_rows_pf(const float* table, int D, const int* idx, int nbags, int bag, float* out, int distance);
+extern void embedding_cols(const float* table, int D, const int* idx, int nbags, int bag, float* out);
+
+typedef struct {
+    float* table;
+    int rows;
+    int D;
+    int* idx;
+    int nbags;
+    int bag;
+    int distance;
+} embedding_t;
+
+static void run_scalar(embedding_t* e, float* out) {
+    embedding_scalar(e->table, e->D, e->idx, e->nbags, e->bag, out);
+}
+
+static void run_rows(embedding_t* e, float* out) {
+    embedding_rows(e->table, e->D, e->idx, e->nbags, e->bag, out);
+}
+
+static void run_rows_pf(embedding_t* e, float* out) {
+    embedding_rows_pf(e->table, e->D, e->idx, e->nbags, e->bag, out, e->distance);
+}
+
+static void run_cols(embedding_t* e, float* out) {
+    embedding_cols(e->table, e->D, e->idx, e->nbags, e->bag, out);
+}
+
+typedef void (*embedding_kernel_t)(embedding_t*, float*);
+
+typedef struct {
+    embedding_kernel_t kernel;
+    embedding_t* e;
+    float* out;
+} embedding_run_t;
+
+static void run_embedding(void* arg) {
+    embedding_run_t* run = arg;
+    run->kernel(run->e, run->out);
+}
+
+static double measure_embedding(embedding_kernel_t kernel, embedding_t* e, float* out, int* rep) {
+    embedding_run_t run = {kernel, e, out};
+
+    return measureReps(run_embedding, &run, "embedding", rep);
+}
+
+int main (int argc, char** argv) {
+    LIKWID_MARKER_INIT;
+    LIKWID_MARKER_REGISTER("embedding");
+    embedding_t e;
+    int opt = 0;
+    double zipf = 0.0;
+    double freq = 2.5;
+    struct option long_opts[] = {
+        {"rows",      required_argument,   NULL,   'r'},
+        {"dim",       required_argument,   NULL,   'd'},
+        {"bag",       required_argument,   NULL,   'b'},
+        {"bags",      required_argument,   NULL,   'n'},
+        {"zipf",      required_argument,   NULL,   'z'},
+        {"distance",  required_argument,   NULL,   'p'},
+        {"freq",      required_argument,   NULL,   'f'},
+        {"help",      no_argument,         NULL,   'h'},
+        {0, 0, 0, 0}
+    };
+
+    e.rows = 1 << 20;
+    e.D = 64;
+    e.bag = 40;
+    e.nbags = 4096;
+    e.distance = 8;
+
+    while((opt = getopt_long(argc, argv, "r:d:b:n:z:p:f:h", long_opts, NULL)) != -1) {
+        switch(opt) {
+            case 'r':
+                e.rows = atoi(optarg);
+                break;
+
+            case 'd':
+                e.D = atoi(optarg);
+                break;
+
+            case 'b':
+                e.bag = atoi(optarg);
+                break;
+
+            case 'n':
+                e.nbags = atoi(optarg);
+                break;
+
+            case 'z':
+                zipf = atof(optarg);
+                break;
+
+            case 'p':
+                e.distance = atoi(optarg);
+                break;
+
+            case 'f':
+                freq = atof(optarg);
+                break;
+
+            case 'h':
+            case '?':
+            default:
+                printf("Usage: %s [OPTION]...\n", argv[0]);
+                printf("Embedding bag (lookup and sum pooling) variant for gather benchmark.\n\n");
+                printf("Mandatory arguments to long options are also mandatory for short options.\n");
+                printf("\t-r, --rows=NUMBER       rows of the embedding table (default 1048576).\n");
+                printf("\t-d, --dim=NUMBER        floats per row, multiple of the vector width (default 64).\n");
+                printf("\t-b, --bag=NUMBER        lookups summed per bag, at most %d (default 40).\n", MAX_BAG);
+                printf("\t-n, --bags=NUMBER       bags per pass, rounded up to the vector width (default 4096).\n");
+                printf("\t-z, --zipf=REAL         Zipf exponent of the row indices, 0 is uniform (default 0).\n");
+                printf("\t-p, --distance=NUMBER   prefetch distance in lookups, at most %d (default 8).\n", MAX_DISTANCE);
+                printf("\t-f, --freq=REAL         CPU frequency in GHz (default 2.5).\n");
+                printf("\t-h, --help              display this help message.\n");
+                printf("\n\n");
+                return EXIT_FAILURE;
+        }
+    }
+
+    if(e.D < _VL_ || e.D % _VL_ != 0) {
+        fprintf(stderr, "Row width must be a positive multiple of %d!\n", _VL_);
+        return EXIT_FAILURE;
+    }
+
+    if(e.rows < 1 || (long) e.rows * e.D > 0x7fffffff) {
+        fprintf(stderr, "Number of rows must be positive and the table must have less than 2^31 elements!\n");
+        return EXIT_FAILURE;
+    }
+
+    if(e.bag < 1 || e.bag > MAX_BAG || e.nbags < 1 || e.distance < 0 || e.distance > MAX_DISTANCE) {
+        fprintf(stderr, "Bag size must be between 1 and %d, bags positive and the prefetch distance between 0 and %d!\n", MAX_BAG, MAX_DISTANCE);
+        return EXIT_FAILURE;
+    }
+
+    e.nbags = (e.nbags + _VL_ - 1) / _VL_ * _VL_;
+    const size_t nidx = (size_t) e.nbags * e.bag;
+    const size_t table_bytes = (size_t) e.rows * e.D * sizeof(float);
+    const size_t out_bytes = (size_t) e.nbags * e.D * sizeof(float);
+
+    // Small integers, so sums are exact in any order
+    e.table = (float*) allocate( ARRAY_ALIGNMENT, table_bytes );
+    for(size_t i = 0; i < (size_t) e.rows * e.D; i++) {
+        e.table[i] = (float) (i % 64);
+    }
+
+    // The prefetching kernel reads distance indices past the last bag
+    e.idx = (int*) allocate( ARRAY_ALIGNMENT, (nidx + MAX_DISTANCE) * sizeof(int) );
+    srand48(e.rows);
+    for(size_t i = 0; i < nidx; i++) {
+        e.idx[i] = gatherbench_zipf_index(e.rows, zipf);
+    }
+
+    for(size_t i = nidx; i < nidx + MAX_DISTANCE; i++) {
+        e.idx[i] = 0;
+    }
+
+    float* out = (float*) allocate( ARRAY_ALIGNMENT, out_bytes );
+    float* out_ref = (float*) allocate( ARRAY_ALIGNMENT, out_bytes );
+
+    printf("ISA,Rows,Row Width,Bag Size,Bags,Zipf,Prefetch Distance,Table (kB),Frequency (GHz)\n");
+    printf("%s,%d,%d,%d,%d,%f,%d,%.2f,%f\n\n", ISA_STRING, e.rows, e.D, e.bag, e.nbags, zipf, e.distance, table_bytes / 1000.0, freq);
+    printf("%14s,%14s,%14s,%14s,%14s\n", "Kernel", "time/pass(ms)", "cy/lookup", "Mlookups/s", "GB/s");
+    freq = freq * 1e9;
+
+    const char* kernel_names[NKERNELS] = {"scalar", "rows", "rows+pf", "cols(gather)"};
+    embedding_kernel_t kernels[NKERNELS] = {run_scalar, run_rows, run_rows_pf, run_cols};
+
+    for(int k = 0; k < NKERNELS; k++) {
+        int rep;
+        float* result = (k == 0) ? out_ref : out;
+        double time = measure_embedding(kernels[k], &e, result, &rep);
+
+        for(size_t i = 0; k > 0 && i < (size_t) e.nbags * e.D; i++) {
+            if(result[i] != out_ref[i]) {
+                printf("Verification failed for %s kernel at bag %ld column %ld: %f != %f\n", kernel_names[k], i / e.D, i % e.D, result[i], out_ref[i]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        // Rows read per lookup, written sums are not counted
+        const double lookups = (double) nidx * rep;
+        printf("%14s,%14.6f,%14.4f,%14.2f,%14.2f\n", kernel_names[k],
+                time / rep * 1e3, time * freq / lookups, lookups / time * 1e-6,
+                lookups * e.D * sizeof(float) / time * 1e-9);
+    }
+
+    free(e.table);
+    free(e.idx);
+    free(out);
+    free(out_ref);
+
+    LIKWID_MARKER_CLOSE;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,506 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <unistd.h>
+//---
+#include <likwid-marker.h>
+//---
+#include <gatherbench.h>
+
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+
+#define MAX_ROWS     64
+#define MAX_COLS     64
+#define LABEL_LEN    32
+#define LINE_LEN     256
+
+// One point of the sweep, rows are strides or Zipf exponents and columns
+// array sizes
+typedef struct {
+    char label[LABEL_LEN];
+    int N;
+    double cy_per_elem;
+    int done;
+} point_t;
+
+// Split a comma separated list into normalized row labels, so that resumed
+// runs match the checkpointed points regardless of how the values were typed
+static int parse_rows(const char* list, int zipf, char labels[][LABEL_LEN]) {
+    char* copy = strdup(list);
+    int nrows = 0;
+
+    for(char* tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if(nrows == MAX_ROWS) {
+            fprintf(stderr, "At most %d rows are supported!\n", MAX_ROWS);
+            nrows = -1;
+            break;
+        }
+
+        if(zipf) {
+            const double s = atof(tok);
+            if(s <= 0.0) {
+                fprintf(stderr, "Zipf exponents must be positive!\n");
+                nrows = -1;
+                break;
+            }
+            snprintf(labels[nrows++], LABEL_LEN, "%g", s);
+        } else {
+            const int stride = atoi(tok);
+            if(stride < 1) {
+                fprintf(stderr, "Strides must be positive!\n");
+                nrows = -1;
+                break;
+            }
+            snprintf(labels[nrows++], LABEL_LEN, "%d", stride);
+        }
+    }
+
+    free(copy);
+    return nrows;
+}
+
+// Read the completed points of an earlier run. Returns 0 if the file was
+// written for another configuration, lines cut off by a killed job are
+// ignored and *newline tells whether one has to be appended before new
+// points.
+static int read_checkpoint(const char* path, const char* header, point_t* points, int npoints, int* newline) {
+    char line[LINE_LEN] = "";
+    char label[LABEL_LEN];
+    int N;
+    double cy;
+    FILE* fp;
+
+    *newline = 0;
+    if((fp = fopen(path, "r")) == NULL) {
+        return 1;
+    }
+
+    if(fgets(line, sizeof line, fp) != NULL && strcmp(line, header) != 0) {
+        fclose(fp);
+        return 0;
+    }
+
+    size_t len = strlen(line);
+    while(fgets(line, sizeof line, fp) != NULL) {
+        len = strlen(line);
+        if(line[len - 1] != '\n' || sscanf(line, "%31[^,],%d,%lf", label, &N, &cy) != 3) {
+            continue;
+        }
+
+        for(int p = 0; p < npoints; p++) {
+            if(points[p].N == N && strcmp(points[p].label, label) == 0) {
+                points[p].cy_per_elem = cy;
+                points[p].done = 1;
+            }
+        }
+    }
+
+    *newline = len > 0 && line[len - 1] != '\n';
+    fclose(fp);
+    return 1;
+}
+
+// Pin the calling process to the group-th set of cores allowed CPUs, its
+// first touch then places the arrays in the NUMA domain of the group
+static void pin_group(int group, int cores) {
+    cpu_set_t allowed;
+    cpu_set_t set;
+    int skip = group * cores;
+    int n = 0;
+
+    sched_getaffinity(0, sizeof(cpu_set_t), &allowed);
+    CPU_ZERO(&set);
+    for(int c = 0; c < CPU_SETSIZE && n < cores; c++) {
+        if(CPU_ISSET(c, &allowed)) {
+            if(skip > 0) {
+                skip--;
+            } else {
+                CPU_SET(c, &set);
+                n++;
+            }
+        }
+    }
+
+    if(n < cores) {
+        fprintf(stderr, "Warning: not enough CPUs for core group %d, running unpinned\n", group);
+        return;
+    }
+
+    if(sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0) {
+        fprintf(stderr, "Warning: could not pin core group %d\n", group);
+    }
+}
+
+// Measure the pending points assigned to worker and append each one to the
+// checkpoint as a single write, so that points of concurrent workers do not
+// interleave
+static int run_worker(const gatherbench_t* config, int zipf, point_t* points, int npoints, int worker, int nworkers, int fd) {
+    int pending = 0;
+
+    for(int p = 0; p < npoints; p++) {
+        if(points[p].done || pending++ % nworkers != worker) {
+            continue;
+        }
+
+        gatherbench_t bench = *config;
+        gatherbench_result_t res;
+        bench.N = points[p].N;
+        if(zipf) {
+            bench.zipf = atof(points[p].label);
+        } else {
+            bench.stride = atoi(points[p].label);
+        }
+
+        if(!gatherbench_init(&bench) || !gatherbench_run(&bench, &res)) {
+            return 0;
+        }
+
+#ifdef TEST
+        if(!res.test) {
+            fprintf(stderr, "Test failed for %s %s, N %d!\n", zipf ? "zipf" : "stride", points[p].label, points[p].N);
+            return 0;
+        }
+#endif
+
+        char line[LINE_LEN];
+        const int len = snprintf(line, sizeof line, "%s,%d,%f\n", points[p].label, points[p].N, res.cy_per_elem);
+        if(write(fd, line, len) != len) {
+            fprintf(stderr, "Error: could not write checkpoint: %s\n", strerror(errno));
+            return 0;
+        }
+
+        printf("%14s,%14d,%14.6f\n", points[p].label, points[p].N, res.cy_per_elem);
+        fflush(stdout);
+        gatherbench_free(&bench);
+    }
+
+    return 1;
+}
+
+int main (int argc, char** argv) {
+    LIKWID_MARKER_INIT;
+    LIKWID_MARKER_REGISTER("gather");
+    const char* kernel = "gather";
+    const char* layout = "AoS";
+    const char* rows = "1,2,4,8,16,32";
+    const char* output = NULL;
+    const char* matrix = NULL;
+    int zipf = 0;
+    int dims = 0;
+    int min_N = 1024;
+    int max_N = 4000000;
+    int cl_size = 64;
+    int nworkers = 1;
+    int cores = 1;
+    int opt = 0;
+    double freq = 2.5;
+    struct option long_opts[] = {
+        {"kernel",  required_argument,   NULL,   'k'},
+        {"layout",  required_argument,   NULL,   'L'},
+        {"dims",    required_argument,   NULL,   'd'},
+        {"strides", required_argument,   NULL,   's'},
+        {"zipf",    required_argument,   NULL,   'z'},
+        {"min",     required_argument,   NULL,   'm'},
+        {"max",     required_argument,   NULL,   'n'},
+        {"freq",    required_argument,   NULL,   'f'},
+        {"line",    required_argument,   NULL,   'l'},
+        {"output",  required_argument,   NULL,   'o'},
+        {"matrix",  required_argument,   NULL,   'x'},
+        {"workers", required_argument,   NULL,   'w'},
+        {"cores",   required_argument,   NULL,   'c'},
+        {"help",    no_argument,         NULL,   'h'},
+        {0, 0, 0, 0}
+    };
+
+    while((opt = getopt_long(argc, argv, "k:L:d:s:z:m:n:f:l:o:x:w:c:h", long_opts, NULL)) != -1) {
+        switch(opt) {
+            case 'k':
+                kernel = optarg;
+                break;
+
+            case 'L':
+                layout = optarg;
+                break;
+
+            case 'd':
+                dims = atoi(optarg);
+                break;
+
+            case 's':
+                rows = optarg;
+                zipf = 0;
+                break;
+
+            case 'z':
+                rows = optarg;
+                zipf = 1;
+                break;
+
+            case 'm':
+                min_N = atoi(optarg);
+                break;
+
+            case 'n':
+                max_N = atoi(optarg);
+                break;
+
+            case 'f':
+                freq = atof(optarg);
+                break;
+
+            case 'l':
+                cl_size = atoi(optarg);
+                break;
+
+            case 'o':
+                output = optarg;
+                break;
+
+            case 'x':
+                matrix = optarg;
+                break;
+
+            case 'w':
+                nworkers = atoi(optarg);
+                break;
+
+            case 'c':
+                cores = atoi(optarg);
+                break;
+
+            case 'h':
+            case '?':
+            default:
+                printf("Usage: %s [OPTION]...\n", argv[0]);
+                printf("Resumable stride (or Zipf exponent) by N sweep for gather benchmark.\n\n");
+                printf("Mandatory arguments to long options are also mandatory for short options.\n");
+                printf("\t-k, --kernel=STRING     gather, dims or coalesce (default gather).\n");
+                printf("\t-L, --layout=STRING     AoS, SoA or AoSoA for the dims and coalesce kernels (default AoS).\n");
+                printf("\t-d, --dims=NUMBER       components per element (default 1 for gather, 3 otherwise).\n");
+                printf("\t-s, --strides=LIST      comma separated strides of the rows (default 1,2,4,8,16,32).\n");
+                printf("\t-z, --zipf=LIST         comma separated Zipf exponents of the rows instead of strides.\n");
+                printf("\t-m, --min=NUMBER        smallest N, grown by 1.5 per column (default 1024).\n");
+                printf("\t-n, --max=NUMBER        largest N (default 4000000).\n");
+                printf("\t-f, --freq=REAL         CPU frequency in GHz (default 2.5).\n");
+                printf("\t-l, --line=NUMBER       cache line size in bytes (default 64).\n");
+                printf("\t-o, --output=STRING     checkpoint file, completed points are appended and skipped when resuming.\n");
+                printf("\t-x, --matrix=STRING     write the cy/elem matrix to this CSV file instead of stdout.\n");
+                printf("\t-w, --workers=NUMBER    worker processes sharing the points (default 1).\n");
+                printf("\t-c, --cores=NUMBER      CPUs per worker core group (default 1).\n");
+                printf("\t-h, --help              display this help message.\n");
+                printf("\n\n");
+                return EXIT_FAILURE;
+        }
+    }
+
+    if(output == NULL) {
+        fprintf(stderr, "Checkpoint file not specified!\n");
+        return EXIT_FAILURE;
+    }
+
+    if(min_N < 1 || max_N < min_N) {
+        fprintf(stderr, "N range must be positive and not empty!\n");
+        return EXIT_FAILURE;
+    }
+
+    if(nworkers < 1 || cores < 1) {
+        fprintf(stderr, "Number of workers and cores per group must be positive!\n");
+        return EXIT_FAILURE;
+    }
+
+    gatherbench_t config = { .index = zipf ? GB_INDEX_ZIPF : GB_INDEX_STRIDE, .dims = dims, .cl_size = cl_size, .freq = freq };
+    if(strcasecmp(kernel, "gather") == 0) {
+        config.kernel = GB_KERNEL_GATHER;
+    } else if(strcasecmp(kernel, "dims") == 0) {
+        config.kernel = GB_KERNEL_DIMS;
+    } else if(strcasecmp(kernel, "coalesce") == 0) {
+        config.kernel = GB_KERNEL_COALESCE;
+    } else {
+        fprintf(stderr, "Unknown kernel %s, possible values are: gather, dims and coalesce\n", kernel);
+        return EXIT_FAILURE;
+    }
+
+    if(strcasecmp(layout, "aos") == 0) {
+        config.layout = GB_LAYOUT_AOS;
+    } else if(strcasecmp(layout, "soa") == 0) {
+        config.layout = GB_LAYOUT_SOA;
+    } else if(strcasecmp(layout, "aosoa") == 0) {
+        config.layout = GB_LAYOUT_AOSOA;
+    } else {
+        fprintf(stderr, "Unknown layout %s, possible values are: AoS, SoA and AoSoA\n", layout);
+        return EXIT_FAILURE;
+    }
+
+    // Also fills in the defaults for the header
+    gatherbench_t probe = config;
+    probe.N = min_N;
+    probe.stride = 1;
+    probe.zipf = 1.0;
+    if(!gatherbench_init(&probe)) {
+        return EXIT_FAILURE;
+    }
+    gatherbench_free(&probe);
+
+    char labels[MAX_ROWS][LABEL_LEN];
+    const int nrows = parse_rows(rows, zipf, labels);
+    if(nrows < 1) {
+        return EXIT_FAILURE;
+    }
+
+    int sizes[MAX_COLS];
+    int ncols = 0;
+    for(int N = min_N; N <= max_N && ncols < MAX_COLS; N = MAX((int) (1.5 * N), N + 1)) {
+        sizes[ncols++] = N;
+    }
+
+    const int npoints = nrows * ncols;
+    point_t* points = (point_t*) calloc(npoints, sizeof(point_t));
+    for(int r = 0; r < nrows; r++) {
+        for(int c = 0; c < ncols; c++) {
+            strcpy(points[r * ncols + c].label, labels[r]);
+            points[r * ncols + c].N = sizes[c];
+        }
+    }
+
+    // The points only depend on the kernel, not on which rows and columns
+    // were requested, so a resumed run may extend the sweep
+    char header[LINE_LEN];
+    const char* layout_name = (config.kernel == GB_KERNEL_GATHER) ? "-" : gatherbench_layout_name(config.layout);
+    snprintf(header, sizeof header, "# %s,%s,%s,%s,dims %d,freq %f,line %d\n", gatherbench_isa(), gatherbench_kernel_name(config.kernel), layout_name, zipf ? "zipf" : "stride", probe.dims, freq, cl_size);
+
+    int newline;
+    if(!read_checkpoint(output, header, points, npoints, &newline)) {
+        fprintf(stderr, "Checkpoint %s was written for another configuration!\n", output);
+        return EXIT_FAILURE;
+    }
+
+    int ndone = 0;
+    for(int p = 0; p < npoints; p++) {
+        ndone += points[p].done;
+    }
+
+    const int fd = open(output, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(fd < 0) {
+        fprintf(stderr, "Error: could not open checkpoint %s: %s\n", output, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    const char* start = newline ? "\n" : "";
+    if(lseek(fd, 0, SEEK_END) == 0) {
+        start = header;
+    }
+    if(write(fd, start, strlen(start)) != (ssize_t) strlen(start)) {
+        fprintf(stderr, "Error: could not write checkpoint %s\n", output);
+        return EXIT_FAILURE;
+    }
+
+    printf("ISA,Kernel,Layout,Pattern,Dims,Frequency (GHz),Cache Line Size (B),Vector Width (e),Points,Resumed,Workers,Cores/Worker\n");
+    printf("%s,%s,%s,%s,%d,%f,%d,%d,%d,%d,%d,%d\n\n", gatherbench_isa(), gatherbench_kernel_name(config.kernel), layout_name, zipf ? "zipf" : "stride", probe.dims, freq, cl_size, gatherbench_vector_width(), npoints, ndone, nworkers, cores);
+    printf("%14s,%14s,%14s\n", zipf ? "zipf" : "stride", "N", "cy/elem");
+    fflush(stdout);
+
+    int failed = 0;
+    if(nworkers == 1) {
+        pin_group(0, cores);
+        failed = !run_worker(&config, zipf, points, npoints, 0, 1, fd);
+    } else {
+        for(int w = 0; w < nworkers; w++) {
+            const pid_t pid = fork();
+            if(pid < 0) {
+                fprintf(stderr, "Error: could not start worker %d\n", w);
+                nworkers = w;
+                failed = 1;
+                break;
+            }
+
+            if(pid == 0) {
+                pin_group(w, cores);
+                exit(run_worker(&config, zipf, points, npoints, w, nworkers, fd) ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+        }
+
+        for(int w = 0; w < nworkers; w++) {
+            int status;
+            if(wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+                failed = 1;
+            }
+        }
+    }
+    close(fd);
+
+    // The workers only reported to the checkpoint
+    if(!read_checkpoint(output, header, points, npoints, &newline)) {
+        return EXIT_FAILURE;
+    }
+
+    FILE* fp = stdout;
+    if(matrix != NULL && (fp = fopen(matrix, "w")) == NULL) {
+        fprintf(stderr, "Error: could not open matrix file %s\n", matrix);
+        return EXIT_FAILURE;
+    }
+
+    // cy/elem with one row per stride or exponent and one column per N,
+    // points that are still missing are left empty
+    if(fp == stdout) {
+        printf("\n");
+    }
+    fprintf(fp, "%s\\N", zipf ? "zipf" : "stride");
+    for(int c = 0; c < ncols; c++) {
+        fprintf(fp, ",%d", sizes[c]);
+    }
+    fprintf(fp, "\n");
+    for(int r = 0; r < nrows; r++) {
+        fprintf(fp, "%s", labels[r]);
+        for(int c = 0; c < ncols; c++) {
+            const point_t* pt = &points[r * ncols + c];
+            if(pt->done) {
+                fprintf(fp, ",%f", pt->cy_per_elem);
+            } else {
+                fprintf(fp, ",");
+            }
+        }
+        fprintf(fp, "\n");
+    }
+
+    if(fp != stdout) {
+        fclose(fp);
+    }
+
+    free(points);
+    LIKWID_MARKER_CLOSE;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
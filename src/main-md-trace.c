@@ -36,6 +36,10 @@
 #include <likwid-marker.h>
 //---
 #include <allocate.h>
+#include <aosoa.h>
+#include <gatherbench.h>
+#include <md_generator.h>
+#include <neighbor_order.h>
 #include <timing.h>
 
 #if !defined(ISA_avx2) && !defined (ISA_avx512)
@@ -68,13 +72,14 @@
 #define ISA_STRING "avx2"
 #endif
 
-#ifdef AOS
-#define GATHER gather_md_aos
-#define LOAD(a, i, d, n) load_aos(&a[i * d])
+#if defined(AOS)
+#define LAYOUT GB_LAYOUT_AOS
 #define LAYOUT_STRING "AoS"
+#elif defined(AOSOA)
+#define LAYOUT GB_LAYOUT_AOSOA
+#define LAYOUT_STRING "AoSoA"
 #else
-#define GATHER gather_md_soa
-#define LOAD(a, i, d, n) load_soa(a, i, n)
+#define LAYOUT GB_LAYOUT_SOA
 #define LAYOUT_STRING "SoA"
 #endif
 
@@ -94,23 +99,117 @@
 #   define MEM_TRACE(addr, op)
 #endif
 
-int gather_md_aos(double*, int*, int, double*, int);
-int gather_md_soa(double*, int*, int, double*, int);
-void load_aos(double*);
-void load_soa(double*, int, int);
-
 const char *get_mem_tracer_filename(const char *trace_file) {
     static char fname[64];
     snprintf(fname, sizeof fname, "mem_tracer_%s.txt", trace_file);
     return fname;
 }
 
+// Hardware counters read per timestep from the "gather" region, in the
+// order of the events of the likwid-perfctr group
+#define MAX_EVENTS 16
+
+// Accumulated counters of the "gather" region, returns their number
+static int read_events(double* events) {
+    int nevents = 0;
+#ifdef LIKWID_PERFMON
+    double time;
+    int count;
+    nevents = MAX_EVENTS;
+    LIKWID_MARKER_GET("gather", &nevents, events, &time, &count);
+#else
+    (void) events;
+#endif
+    return nevents;
+}
+
 int log2_uint(unsigned int x) {
     int ans = 0;
     while(x >>= 1) { ans++; }
     return ans;
 }
 
+#if defined(ISA_avx512) && defined(AOS) && !defined(TEST)
+// We inline the assembly for AVX512 with AoS layout to evaluate the impact
+// of calling external assembly procedures in the overall runtime, it does
+// not store the gathered values so TEST builds use gather_md_aos
+static double gather_md_inline(gatherbench_t* bench) {
+    double* a = bench->a;
+    const int snbytes = bench->width;
+    double E, S;
+
+    S = getTimeStamp();
+    LIKWID_MARKER_START("gather");
+    for(int i = 0; i < bench->nlocal; i++) {
+        const int* neighbors = &bench->neighborlists[i * bench->maxneighs];
+        __m256i ymm_reg_mask = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __asm__ __volatile__(   "vmovsd 0(%0), %%xmm3;"
+                                "vmovsd 8(%0), %%xmm4;"
+                                "vmovsd 16(%0), %%xmm5;"
+                                "vbroadcastsd %%xmm3, %%zmm0;"
+                                "vbroadcastsd %%xmm4, %%zmm1;"
+                                "vbroadcastsd %%xmm5, %%zmm2;"
+                                :
+                                : "r" (&a[i * snbytes])
+                                : "%xmm3", "%xmm4", "%xmm5", "%zmm0", "%zmm1", "%zmm2"  );
+
+        __asm__ __volatile__(   "xor %%rax, %%rax;"
+                                "movq %%rdx, %%r15;"
+                                "1: vmovdqu (%1,%%rax,4), %%ymm3;"
+                                "vpaddd %%ymm3, %%ymm3, %%ymm4;"
+                                #ifdef PADDING
+                                "vpaddd %%ymm4, %%ymm4, %%ymm3;"
+                                #else
+                                "vpaddd %%ymm3, %%ymm4, %%ymm3;"
+                                #endif
+                                "vpcmpeqb %%xmm5, %%xmm5, %%k1;"
+                                "vpcmpeqb %%xmm5, %%xmm5, %%k2;"
+                                "vpcmpeqb %%xmm5, %%xmm5, %%k3;"
+                                "vpxord %%zmm0, %%zmm0, %%zmm0;"
+                                "vpxord %%zmm1, %%zmm1, %%zmm1;"
+                                "vpxord %%zmm2, %%zmm2, %%zmm2;"
+                                "vgatherdpd (%3, %%ymm3, 8), %%zmm0%{%%k1%};"
+                                "vgatherdpd 8(%3, %%ymm3, 8), %%zmm1%{%%k2%};"
+                                "vgatherdpd 16(%3, %%ymm3, 8), %%zmm2%{%%k3%};"
+                                "addq $8, %%rax;"
+                                "subq $8, %%r15;"
+                                "cmpq $8, %%r15;"
+                                "jge 1b;"
+                                "cmpq $0, %%r15;"
+                                "jle 2f;"
+                                "vpbroadcastd %%r15d, %%ymm5;"
+                                "vpcmpgtd %%ymm5, %2, %%k1;"
+                                "vmovdqu32 (%1,%%rax,4), %%ymm3%{%%k1%}%{z%};"
+                                "vpaddd %%ymm3, %%ymm3, %%ymm4;"
+                                #ifdef PADDING
+                                "vpaddd %%ymm4, %%ymm4, %%ymm3;"
+                                #else
+                                "vpaddd %%ymm3, %%ymm4, %%ymm3;"
+                                #endif
+                                "vpxord %%zmm0, %%zmm0, %%zmm0;"
+                                "kmovw %%k1, %%k2;"
+                                "kmovw %%k1, %%k3;"
+                                "vpxord %%zmm1, %%zmm1, %%zmm1;"
+                                "vpxord %%zmm2, %%zmm2, %%zmm2;"
+                                "vgatherdpd (%3, %%ymm3, 8), %%zmm0%{%%k1%};"
+                                "vgatherdpd 8(%3, %%ymm3, 8), %%zmm1%{%%k2%};"
+                                "vgatherdpd 16(%3, %%ymm3, 8), %%zmm2%{%%k3%};"
+                                "addq %%r15, %%rax;"
+                                "2:;"
+                                :
+                                : "d" (bench->numneighs[i]), "r" (neighbors), "x" (ymm_reg_mask), "r" (a)
+                                : "%rax", "%r15", "%ymm3", "%ymm4", "%ymm5", "%k1", "%k2", "%k3", "%zmm0", "%zmm1", "%zmm2" );
+        bench->f[i * 3 + 0] += i;
+        bench->f[i * 3 + 1] += i;
+        bench->f[i * 3 + 2] += i;
+    }
+    LIKWID_MARKER_STOP("gather");
+    E = getTimeStamp();
+
+    return E - S;
+}
+#endif
+
 int main (int argc, char** argv) {
     LIKWID_MARKER_INIT;
     LIKWID_MARKER_REGISTER("gather");
@@ -118,23 +217,69 @@ int main (int argc, char** argv) {
     int cl_size = 64;
     int ntimesteps = 200;
     int reneigh_every = 20;
+    int block = _VL_;
     int opt = 0;
     double freq = 2.5;
+    char *generator = NULL;
+    char *order = NULL;
+    char *timeline_file = NULL;
+    int cluster = 4;
+    md_generator_t gen = { .natoms = 32000, .density = 0.8442, .cutoff = 2.5, .skin = 0.3, .perturb = 0.0, .half = 0 };
     struct option long_opts[] = {
         {"trace" ,      required_argument,   NULL,   't'},
+        {"generate",    required_argument,   NULL,   'g'},
+        {"atoms",       required_argument,   NULL,   'a'},
+        {"density",     required_argument,   NULL,   'd'},
+        {"cutoff",      required_argument,   NULL,   'c'},
+        {"skin",        required_argument,   NULL,   's'},
+        {"perturb",     required_argument,   NULL,   'p'},
+        {"half",        no_argument,         NULL,   'H'},
         {"freq",        required_argument,   NULL,   'f'},
         {"line",        required_argument,   NULL,   'l'},
         {"timesteps",   required_argument,   NULL,   'n'},
         {"reneigh",     required_argument,   NULL,   'r'},
-        {"help",        required_argument,   NULL,   'h'}
+        {"block",       required_argument,   NULL,   'b'},
+        {"order",       required_argument,   NULL,   'o'},
+        {"cluster",     required_argument,   NULL,   'k'},
+        {"timeline",    required_argument,   NULL,   'T'},
+        {"help",        no_argument,         NULL,   'h'},
+        {0, 0, 0, 0}
     };
 
-    while((opt = getopt_long(argc, argv, "t:f:l:n:r:h", long_opts, NULL)) != -1) {
+    while((opt = getopt_long(argc, argv, "t:g:a:d:c:s:p:Hf:l:n:r:b:o:k:T:h", long_opts, NULL)) != -1) {
         switch(opt) {
             case 't':
                 trace_file = strdup(optarg);
                 break;
 
+            case 'g':
+                generator = strdup(optarg);
+                break;
+
+            case 'a':
+                gen.natoms = atoi(optarg);
+                break;
+
+            case 'd':
+                gen.density = atof(optarg);
+                break;
+
+            case 'c':
+                gen.cutoff = atof(optarg);
+                break;
+
+            case 's':
+                gen.skin = atof(optarg);
+                break;
+
+            case 'p':
+                gen.perturb = atof(optarg);
+                break;
+
+            case 'H':
+                gen.half = 1;
+                break;
+
             case 'f':
                 freq = atof(optarg);
                 break;
@@ -151,6 +296,22 @@ int main (int argc, char** argv) {
                 reneigh_every = atoi(optarg);
                 break;
 
+            case 'b':
+                block = atoi(optarg);
+                break;
+
+            case 'o':
+                order = strdup(optarg);
+                break;
+
+            case 'k':
+                cluster = atoi(optarg);
+                break;
+
+            case 'T':
+                timeline_file = strdup(optarg);
+                break;
+
             case 'h':
             case '?':
             default:
@@ -158,21 +319,68 @@ int main (int argc, char** argv) {
                 printf("MD variant for gather benchmark.\n\n");
                 printf("Mandatory arguments to long options are also mandatory for short options.\n");
                 printf("\t-t, --trace=STRING        input file with traced indexes from MD-Bench.\n");
+                printf("\t-g, --generate=STRING     generate neighbor lists instead, fcc or random atom positions.\n");
+                printf("\t-a, --atoms=NUMBER        atoms to generate, rounded to full unit cells for fcc (default 32000).\n");
+                printf("\t-d, --density=REAL        atoms per unit volume (default 0.8442).\n");
+                printf("\t-c, --cutoff=REAL         force cutoff radius (default 2.5).\n");
+                printf("\t-s, --skin=REAL           neighbor list skin added to the cutoff (default 0.3).\n");
+                printf("\t-p, --perturb=REAL        maximum random displacement per coordinate and timestep (default 0).\n");
+                printf("\t-H, --half                build half instead of full neighbor lists.\n");
                 printf("\t-f, --freq=REAL           CPU frequency in GHz (default 2.5).\n");
                 printf("\t-l, --line=NUMBER         cache line size in bytes (default 64).\n");
                 printf("\t-n, --timesteps=NUMBER    number of timesteps to simulate (default 200).\n");
                 printf("\t-r, --reneigh=NUMBER      reneighboring frequency in timesteps (default 20).\n");
+                printf("\t-b, --block=NUMBER        elements per block in AoSoA layout, power of two (default %d).\n", _VL_);
+                printf("\t-o, --order=STRING        preprocess the lists at each reneighboring: none, index, cacheline or cluster (default none).\n");
+                printf("\t-k, --cluster=NUMBER      atoms per cluster for --order=cluster (default 4).\n");
+                printf("\t-T, --timeline=STRING     write per-timestep gather cost to this CSV file and summarize it per reneighboring.\n");
                 printf("\t-h, --help                display this help message.\n");
                 printf("\n\n");
                 return EXIT_FAILURE;
         }
     }
 
+    if(generator != NULL) {
+        if(strcmp(generator, "fcc") != 0 && strcmp(generator, "random") != 0) {
+            fprintf(stderr, "Unknown generator %s, possible values are: fcc and random\n", generator);
+            return EXIT_FAILURE;
+        }
+
+        gen.fcc = strcmp(generator, "fcc") == 0;
+        if(!md_generator_init(&gen)) {
+            return EXIT_FAILURE;
+        }
+
+        // Generated lists are named after the generator in memory traces
+        trace_file = generator;
+    }
+
     if(trace_file == NULL) {
         fprintf(stderr, "Trace file not specified!\n");
         return EXIT_FAILURE;
     }
 
+    if(block < 1 || (block & (block - 1)) != 0) {
+        fprintf(stderr, "Block size must be a power of two!\n");
+        return EXIT_FAILURE;
+    }
+
+    neighbor_order_mode_t order_mode = NEIGHBOR_ORDER_NONE;
+    if(order != NULL && !neighbor_order_parse(order, &order_mode)) {
+        fprintf(stderr, "Unknown order %s, possible values are: none, index, cacheline and cluster\n", order);
+        return EXIT_FAILURE;
+    }
+
+    if(cluster < 1) {
+        fprintf(stderr, "Cluster size must be positive!\n");
+        return EXIT_FAILURE;
+    }
+
+    if(ntimesteps < 0 || reneigh_every < 1) {
+        fprintf(stderr, "Number of timesteps cannot be negative and reneighboring frequency must be positive!\n");
+        return EXIT_FAILURE;
+    }
+
     FILE *fp;
     char *line = NULL;
     int *neighborlists = NULL;
@@ -180,22 +388,40 @@ int main (int argc, char** argv) {
     int atom = -1;
     int nlocal, nghost, maxneighs;
     int nall = 0;
-    int N_alloc = 0;
-    size_t ntest = 0;
     size_t llen;
     ssize_t read;
-    double *a = NULL;
-    double *f = NULL;
-    double *t = NULL;
     double time = 0.0;
-    double E, S;
+    double time_base = 0.0;
+    double time_order = 0.0;
+    int nbuilds = 0;
     const int dims = 3;
     const int snbytes = dims + PADDING_BYTES; // bytes per element (struct), includes padding
     long long int niters = 0;
     long long int ngathered = 0;
-
-    printf("ISA,Layout,Dims,Frequency (GHz),Cache Line Size (B),Vector Width (e)\n");
+    long long int ngathered_base = 0;
+    gatherbench_t bench = { .kernel = GB_KERNEL_MD, .layout = LAYOUT, .index = GB_INDEX_NEIGHBORS, .dims = dims, .width = snbytes, .block = block, .cl_size = cl_size, .freq = freq };
+    // With preprocessing, bench runs the preprocessed and baseline the
+    // original lists on the same positions
+    gatherbench_t baseline = bench;
+    neighbor_order_t ord = { .mode = order_mode, .cluster = cluster, .layout = LAYOUT, .width = snbytes, .block = block, .dims = dims, .cl_size = cl_size };
+
+    printf("ISA,Layout,Dims,Frequency (GHz),Cache Line Size (B),Vector Width (e)");
+    #ifdef AOSOA
+    printf(",Block (e)\n");
+    printf("%s,%s,%d,%f,%d,%d,%d\n\n", ISA_STRING, LAYOUT_STRING, dims, freq, cl_size, _VL_, block);
+    #else
+    printf("\n");
     printf("%s,%s,%d,%f,%d,%d\n\n", ISA_STRING, LAYOUT_STRING, dims, freq, cl_size, _VL_);
+    #endif
+    if(generator != NULL) {
+        printf("Generator,Atoms,Density,Cutoff,Skin,Perturbation,Lists\n");
+        printf("%s,%d,%f,%f,%f,%f,%s\n\n", generator, gen.nlocal, gen.density, gen.cutoff, gen.skin, gen.perturb, gen.half ? "half" : "full");
+    }
+    if(order_mode != NEIGHBOR_ORDER_NONE) {
+        printf("Neighbor Order,Cluster Size (e),Reneighboring (steps)\n");
+        printf("%s,%d,%d\n\n", neighbor_order_name(order_mode), (order_mode == NEIGHBOR_ORDER_CLUSTER) ? cluster : 0, reneigh_every);
+    }
+
     freq = freq * 1e9;
 
     #ifdef ONLY_FIRST_DIMENSION
@@ -204,181 +430,188 @@ int main (int argc, char** argv) {
     const int gathered_dims = dims;
     #endif
 
+    // Per-timestep record for the timeline, step 0 is the first build
+    const int nsteps = ntimesteps + 1;
+    double* step_time = NULL;
+    double* step_time_base = NULL;
+    long* step_elems = NULL;
+    long* step_elems_base = NULL;
+    int* step_N = NULL;
+    double* step_events = NULL;
+    int nevents = 0;
+    if(timeline_file != NULL) {
+        step_time = (double*) allocate( ARRAY_ALIGNMENT, nsteps * sizeof(double) );
+        step_time_base = (double*) allocate( ARRAY_ALIGNMENT, nsteps * sizeof(double) );
+        step_elems = (long*) allocate( ARRAY_ALIGNMENT, nsteps * sizeof(long) );
+        step_elems_base = (long*) allocate( ARRAY_ALIGNMENT, nsteps * sizeof(long) );
+        step_N = (int*) allocate( ARRAY_ALIGNMENT, nsteps * sizeof(int) );
+        step_events = (double*) allocate( ARRAY_ALIGNMENT, (size_t) nsteps * MAX_EVENTS * sizeof(double) );
+    }
+
     for(int ts = -1; ts < ntimesteps; ts++) {
+        if(generator != NULL && ts >= 0) {
+            md_generator_step(&gen);
+        }
+
         if(!((ts + 1) % reneigh_every)) {
-            char ts_trace_file[128];
-            snprintf(ts_trace_file, sizeof ts_trace_file, "%s_%d.out", trace_file, ts + 1);
-            if((fp = fopen(ts_trace_file, "r")) == NULL) {
-                fprintf(stderr, "Error: could not open trace file!\n");
-                return EXIT_FAILURE;
-            }
+            if(generator != NULL) {
+                md_generator_build(&gen);
+                nlocal = gen.nlocal;
+                nghost = gen.nghost;
+                nall = nlocal + nghost;
+                maxneighs = gen.maxneighs;
+                neighborlists = gen.neighborlists;
+                numneighs = gen.numneighs;
+            } else {
+                char ts_trace_file[128];
+                snprintf(ts_trace_file, sizeof ts_trace_file, "%s_%d.out", trace_file, ts + 1);
+                if((fp = fopen(ts_trace_file, "r")) == NULL) {
+                    fprintf(stderr, "Error: could not open trace file!\n");
+                    return EXIT_FAILURE;
+                }
 
-            while((read = getline(&line, &llen, fp)) != -1) {
-                int i = 2;
-                if(strncmp(line, "N:", 2) == 0) {
-                    while(line[i] == ' ') { i++; }
-                    nlocal = atoi(strtok(&line[i], " "));
-                    nghost = atoi(strtok(NULL, " "));
-                    nall = nlocal + nghost;
-                    maxneighs = atoi(strtok(NULL, " "));
-
-                    if(nlocal <= 0 || maxneighs <= 0) {
-                        fprintf(stderr, "Number of local atoms and neighbor lists capacity cannot be less or equal than zero!\n");
-                        return EXIT_FAILURE;
+                while((read = getline(&line, &llen, fp)) != -1) {
+                    int i = 2;
+                    if(strncmp(line, "N:", 2) == 0) {
+                        while(line[i] == ' ') { i++; }
+                        nlocal = atoi(strtok(&line[i], " "));
+                        nghost = atoi(strtok(NULL, " "));
+                        nall = nlocal + nghost;
+                        maxneighs = atoi(strtok(NULL, " "));
+
+                        if(nlocal <= 0 || maxneighs <= 0) {
+                            fprintf(stderr, "Number of local atoms and neighbor lists capacity cannot be less or equal than zero!\n");
+                            return EXIT_FAILURE;
+                        }
+
+                        if(neighborlists == NULL) {
+                            neighborlists = (int *) allocate( ARRAY_ALIGNMENT, nlocal * maxneighs * sizeof(int) );
+                            numneighs = (int *) allocate( ARRAY_ALIGNMENT, nlocal * sizeof(int) );
+                        }
                     }
 
-                    if(neighborlists == NULL) {
-                        neighborlists = (int *) allocate( ARRAY_ALIGNMENT, nlocal * maxneighs * sizeof(int) );
-                        numneighs = (int *) allocate( ARRAY_ALIGNMENT, nlocal * sizeof(int) );
+                    if(strncmp(line, "A:", 2) == 0) {
+                        while(line[i] == ' ') { i++; }
+                        atom = atoi(strtok(&line[i], " "));
+                        numneighs[atom] = 0;
                     }
-                }
 
-                if(strncmp(line, "A:", 2) == 0) {
-                    while(line[i] == ' ') { i++; }
-                    atom = atoi(strtok(&line[i], " "));
-                    numneighs[atom] = 0;
+                    if(strncmp(line, "I:", 2) == 0) {
+                        while(line[i] == ' ') { i++; }
+                        char *neigh_idx = strtok(&line[i], " ");
+
+                        while(neigh_idx != NULL && *neigh_idx != '\n') {
+                            int j = numneighs[atom];
+                            neighborlists[atom * maxneighs + j] = atoi(neigh_idx);
+                            numneighs[atom]++;
+                            neigh_idx = strtok(NULL, " ");
+                        }
+                    }
                 }
 
-                if(strncmp(line, "I:", 2) == 0) {
-                    while(line[i] == ' ') { i++; }
-                    char *neigh_idx = strtok(&line[i], " ");
+                fclose(fp);
+            }
 
-                    while(neigh_idx != NULL && *neigh_idx != '\n') {
-                        int j = numneighs[atom];
-                        neighborlists[atom * maxneighs + j] = atoi(neigh_idx);
-                        numneighs[atom]++;
-                        ntest++;
-                        neigh_idx = strtok(NULL, " ");
-                    }
+            // Generated systems can gain ghost atoms between rebuilds
+            bench.N = nall;
+            bench.nlocal = nlocal;
+            bench.maxneighs = maxneighs;
+            bench.neighborlists = neighborlists;
+            bench.numneighs = numneighs;
+
+            if(order_mode != NEIGHBOR_ORDER_NONE) {
+                baseline.N = nall;
+                baseline.nlocal = nlocal;
+                baseline.maxneighs = maxneighs;
+                baseline.neighborlists = neighborlists;
+                baseline.numneighs = numneighs;
+                if(!gatherbench_init(&baseline)) {
+                    return EXIT_FAILURE;
                 }
+
+                double S = getTimeStamp();
+                neighbor_order_apply(&ord, nlocal, nall, maxneighs, neighborlists, numneighs);
+                double E = getTimeStamp();
+                time_order += E - S;
+
+                bench.maxneighs = ord.maxneighs;
+                bench.neighborlists = ord.neighborlists;
+                bench.numneighs = ord.numneighs;
             }
 
-            fclose(fp);
-        }
+            if(!gatherbench_init(&bench)) {
+                return EXIT_FAILURE;
+            }
 
-        if(N_alloc == 0) {
-            N_alloc = nall * 2;
-            a = (double*) allocate( ARRAY_ALIGNMENT, N_alloc * snbytes * sizeof(double) );
-            f = (double*) allocate( ARRAY_ALIGNMENT, N_alloc * dims * sizeof(double) );
+            nbuilds++;
         }
 
-        #ifdef TEST
-        if(t != NULL) { free(t); }
-        ntest += 100;
-        t = (double*) allocate( ARRAY_ALIGNMENT, ntest * dims * sizeof(double) );
-        #endif
-
-        for(int i = 0; i < N_alloc; ++i) {
-            #ifdef AOS
-            a[i * snbytes + 0] = i * dims + 0;
-            a[i * snbytes + 1] = i * dims + 1;
-            a[i * snbytes + 2] = i * dims + 2;
-            #else
-            a[N * 0 + i] = N * 0 + i;
-            a[N * 1 + i] = N * 1 + i;
-            a[N * 2 + i] = N * 2 + i;
-            #endif
-            f[i * dims + 0] = 0.0;
-            f[i * dims + 1] = 0.0;
-            f[i * dims + 2] = 0.0;
+        // Counters are read around the preprocessed lists only, the
+        // baseline runs in the same region afterwards
+        const int step = ts + 1;
+        double events_before[MAX_EVENTS];
+        double events_after[MAX_EVENTS];
+        if(step_time != NULL) {
+            nevents = read_events(events_before);
         }
 
-        int t_idx = 0;
-        S = getTimeStamp();
-        LIKWID_MARKER_START("gather");
-        for(int i = 0; i < nlocal; i++) {
-            int *neighbors = &neighborlists[i * maxneighs];
-            // We inline the assembly for AVX512 with AoS layout to evaluate the impact
-            // of calling external assembly procedures in the overall runtime
-            #ifdef ISA_avx512
-            __m256i ymm_reg_mask = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
-            __asm__ __volatile__(   "vmovsd 0(%0), %%xmm3;"
-                                    "vmovsd 8(%0), %%xmm4;"
-                                    "vmovsd 16(%0), %%xmm5;"
-                                    "vbroadcastsd %%xmm3, %%zmm0;"
-                                    "vbroadcastsd %%xmm4, %%zmm1;"
-                                    "vbroadcastsd %%xmm5, %%zmm2;"
-                                    :
-                                    : "r" (&a[i * snbytes])
-                                    : "%xmm3", "%xmm4", "%xmm5", "%zmm0", "%zmm1", "%zmm2"  );
-
-            __asm__ __volatile__(   "xor %%rax, %%rax;"
-                                    "movq %%rdx, %%r15;"
-                                    "1: vmovdqu (%1,%%rax,4), %%ymm3;"
-                                    "vpaddd %%ymm3, %%ymm3, %%ymm4;"
-                                    #ifdef PADDING
-                                    "vpaddd %%ymm4, %%ymm4, %%ymm3;"
-                                    #else
-                                    "vpaddd %%ymm3, %%ymm4, %%ymm3;"
-                                    #endif
-                                    "vpcmpeqb %%xmm5, %%xmm5, %%k1;"
-                                    "vpcmpeqb %%xmm5, %%xmm5, %%k2;"
-                                    "vpcmpeqb %%xmm5, %%xmm5, %%k3;"
-                                    "vpxord %%zmm0, %%zmm0, %%zmm0;"
-                                    "vpxord %%zmm1, %%zmm1, %%zmm1;"
-                                    "vpxord %%zmm2, %%zmm2, %%zmm2;"
-                                    "vgatherdpd (%3, %%ymm3, 8), %%zmm0{{%%k1}};"
-                                    "vgatherdpd 8(%3, %%ymm3, 8), %%zmm1{{%%k2}};"
-                                    "vgatherdpd 16(%3, %%ymm3, 8), %%zmm2{{%%k3}};"
-                                    "addq $8, %%rax;"
-                                    "subq $8, %%r15;"
-                                    "cmpq $8, %%r15;"
-                                    "jge 1b;"
-                                    "cmpq $0, %%r15;"
-                                    "jle 2;"
-                                    "vpbroadcastd %%r15d, %%ymm5;"
-                                    "vpcmpgtd %%ymm5, %2, %%k1;"
-                                    "vmovdqu32 (%1,%%rax,4), %%ymm3{{%%k1}}{{z}};"
-                                    "vpaddd %%ymm3, %%ymm3, %%ymm4;"
-                                    #ifdef PADDING
-                                    "vpaddd %%ymm4, %%ymm4, %%ymm3;"
-                                    #else
-                                    "vpaddd %%ymm3, %%ymm4, %%ymm3;"
-                                    #endif
-                                    "vpxord %%zmm0, %%zmm0, %%zmm0;"
-                                    "kmovw %%k1, %%k2;"
-                                    "kmovw %%k1, %%k3;"
-                                    "vpxord %%zmm1, %%zmm1, %%zmm1;"
-                                    "vpxord %%zmm2, %%zmm2, %%zmm2;"
-                                    "vgatherdpd (%3, %%ymm3, 8), %%zmm0{{%%k1}};"
-                                    "vgatherdpd 8(%3, %%ymm3, 8), %%zmm1{{%%k2}};"
-                                    "vgatherdpd 16(%3, %%ymm3, 8), %%zmm2{{%%k3}};"
-                                    "addq %%r15, %%rax;"
-                                    "2:;"
-                                    :
-                                    : "d" (numneighs[i]), "r" (neighbors), "x" (ymm_reg_mask), "r" (a)
-                                    : "%rax", "%r15", "%ymm3", "%ymm4", "%ymm5", "%k1", "%k2", "%k3", "%zmm0", "%zmm1", "%zmm2" );
-            #else
-            LOAD(a, i, snbytes, N_alloc);
-            t_idx += GATHER(a, neighbors, numneighs[i], &t[t_idx], ntest);
-            #endif
-            f[i * dims + 0] += i;
-            f[i * dims + 1] += i;
-            f[i * dims + 2] += i;
+        double t_step = 0.0;
+        double t_base = 0.0;
+        #if defined(ISA_avx512) && defined(AOS) && !defined(TEST)
+        t_step = gather_md_inline(&bench);
+        if(step_time != NULL) {
+            read_events(events_after);
+        }
+        if(order_mode != NEIGHBOR_ORDER_NONE) {
+            t_base = gather_md_inline(&baseline);
+        }
+        #else
+        t_step = gatherbench_time(&bench, 1);
+        if(step_time != NULL) {
+            read_events(events_after);
+        }
+        if(order_mode != NEIGHBOR_ORDER_NONE) {
+            t_base = gatherbench_time(&baseline, 1);
+        }
+        #endif
+        time += t_step;
+        time_base += t_base;
+
+        if(step_time != NULL) {
+            step_time[step] = t_step;
+            step_time_base[step] = t_base;
+            step_elems[step] = bench.elems;
+            step_elems_base[step] = baseline.elems;
+            step_N[step] = nall;
+            for(int k = 0; k < nevents; k++) {
+                step_events[step * MAX_EVENTS + k] = events_after[k] - events_before[k];
+            }
         }
-        LIKWID_MARKER_STOP("gather");
-        E = getTimeStamp();
-        time += E - S;
 
         #ifdef MEM_TRACER
+        double* a = bench.a;
         MEM_TRACER_INIT(trace_file);
         for(int i = 0; i < nlocal; i++) {
-            int *neighbors = &neighborlists[i * maxneighs];
+            const int *neighbors = &bench.neighborlists[i * bench.maxneighs];
 
             for(int d = 0; d < gathered_dims; d++) {
-                #ifdef AOS
+                #if defined(AOS)
                 MEM_TRACE('R', a[i * snbytes + d])
+                #elif defined(AOSOA)
+                MEM_TRACE('R', a[AOSOA_IDX(i, d, block, dims)])
                 #else
                 MEM_TRACE('R', a[d * N + i])
                 #endif
             }
 
-            for(int j = 0; j < numneighs[i]; j += _VL_) {
-                for(int jj = j; jj < MIN(j + _VL_, numneighs[i]); j++) {
+            for(int j = 0; j < bench.numneighs[i]; j += _VL_) {
+                for(int jj = j; jj < MIN(j + _VL_, bench.numneighs[i]); j++) {
                     int k = neighbors[jj];
                     for(int d = 0; d < gathered_dims; d++) {
-                        #ifdef AOS
+                        #if defined(AOS)
                         MEM_TRACE('R', a[k * snbytes + d])
+                        #elif defined(AOSOA)
+                        MEM_TRACE('R', a[AOSOA_IDX(k, d, block, dims)])
                         #else
                         MEM_TRACE('R', a[d * N + k])
                         #endif
@@ -390,52 +623,139 @@ int main (int argc, char** argv) {
         #endif
 
         #ifdef TEST
-        int test_failed = 0;
-        t_idx = 0;
-        for(int i = 0; i < nlocal; ++i) {
-            int *neighbors = &neighborlists[i * maxneighs];
-            for(int j = 0; j < numneighs[i]; ++j) {
-                int k = neighbors[j];
-                for(int d = 0; d < dims; ++d) {
-                    #ifdef AOS
-                    if(t[d * ntest + t_idx] != k * dims + d) {
-                    #else
-                    if(t[d * ntest + t_idx] != d * N + k) {
-                    #endif
-                        test_failed = 1;
-                        break;
-                    }
-                }
-
-                t_idx++;
-            }
-        }
-
-        if(test_failed) {
+        if(!gatherbench_check(&bench) || (order_mode != NEIGHBOR_ORDER_NONE && !gatherbench_check(&baseline))) {
             printf("Test failed!\n");
             return EXIT_FAILURE;
         }
         #endif
 
-        for(int i = 0; i < nlocal; i++) {
-            niters += (numneighs[i] / _VL_) + ((numneighs[i] % _VL_ == 0) ? 0 : 1);
-            ngathered += numneighs[i];
-        }
+        niters += bench.its;
+        ngathered += bench.elems;
+        ngathered_base += baseline.elems;
     }
 
     printf("%14s,%14s,%14s,%14s,%14s,%14s", "tot. time(s)", "time/step(ms)", "time/iter(us)", "cy/it", "cy/gather", "cy/elem");
+    if(order_mode != NEIGHBOR_ORDER_NONE) {
+        printf(",%14s,%14s,%14s,%14s,%14s", "base/step(ms)", "order/build(ms)", "elems/base", "saved/step(ms)", "break-even");
+    }
     printf("\n");
     const double time_per_step = time * 1e3 / ((double) ntimesteps);
     const double time_per_it = time * 1e6 / ((double) niters);
     const double cy_per_it = time * freq * _VL_ / ((double) niters);
     const double cy_per_gather = time * freq * _VL_ / ((double) niters * gathered_dims);
     const double cy_per_elem = time * freq / ((double) ngathered * gathered_dims);
-    printf("%14.6f,%14.6f,%14.6f,%14.6f,%14.6f,%14.6f\n", time, time_per_step, time_per_it, cy_per_it, cy_per_gather, cy_per_elem);
+    printf("%14.6f,%14.6f,%14.6f,%14.6f,%14.6f,%14.6f", time, time_per_step, time_per_it, cy_per_it, cy_per_gather, cy_per_elem);
+    if(order_mode != NEIGHBOR_ORDER_NONE) {
+        // Reneighboring interval in steps from which the preprocessing
+        // cost of a build is recovered by faster gathers
+        const double base_per_step = time_base * 1e3 / ((double) ntimesteps);
+        const double order_per_build = time_order * 1e3 / ((double) nbuilds);
+        const double saved_per_step = base_per_step - time_per_step;
+        printf(",%14.6f,%14.6f,%14.6f,%14.6f", base_per_step, order_per_build, (double) ngathered / (double) ngathered_base, saved_per_step);
+        if(saved_per_step > 0.0) {
+            printf(",%14.1f", order_per_build / saved_per_step);
+        } else {
+            printf(",%14s", "never");
+        }
+    }
+    printf("\n");
+
+    if(timeline_file != NULL) {
+        FILE* tl;
+        if((tl = fopen(timeline_file, "w")) == NULL) {
+            fprintf(stderr, "Error: could not open timeline file!\n");
+            return EXIT_FAILURE;
+        }
+
+        // age counts the steps since the last reneighboring
+        fprintf(tl, "step,age,N,elems,time(us),cy/elem");
+        if(order_mode != NEIGHBOR_ORDER_NONE) {
+            fprintf(tl, ",elems(base),time(base,us),cy/elem(base)");
+        }
+        for(int k = 0; k < nevents; k++) {
+            fprintf(tl, ",event%d", k);
+        }
+        fprintf(tl, "\n");
+
+        for(int step = 0; step < nsteps; step++) {
+            fprintf(tl, "%d,%d,%d,%ld,%f,%f", step, step % reneigh_every, step_N[step], step_elems[step], step_time[step] * 1e6, step_time[step] * freq / ((double) step_elems[step] * gathered_dims));
+            if(order_mode != NEIGHBOR_ORDER_NONE) {
+                fprintf(tl, ",%ld,%f,%f", step_elems_base[step], step_time_base[step] * 1e6, step_time_base[step] * freq / ((double) step_elems_base[step] * gathered_dims));
+            }
+            for(int k = 0; k < nevents; k++) {
+                fprintf(tl, ",%f", step_events[step * MAX_EVENTS + k]);
+            }
+            fprintf(tl, "\n");
+        }
+
+        fclose(tl);
+
+        // Cost across each reneighboring: the last step on the old lists
+        // (before) against the first warm step on the new ones (after).
+        // Within an interval every step replays the same lists, only a
+        // rebuild changes the access pattern. The reneighboring step itself
+        // runs on freshly initialized arrays and is listed separately
+        // (build). Without a warm step after a rebuild, there is no row.
+        printf("\n%14s,%14s,%14s,%14s,%14s,%14s", "reneighbor", "step", "cy/elem(before)", "cy/elem(build)", "cy/elem(after)", "change(%)");
+        if(order_mode != NEIGHBOR_ORDER_NONE) {
+            printf(",%14s,%14s", "base(before)", "base(after)");
+        }
+        printf("\n");
+
+        #define STEP_CY_ELEM(t, e, s) ((t)[s] * freq / ((double) (e)[s] * gathered_dims))
+        double sum[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+        int nintervals = 0;
+        for(int build = reneigh_every; reneigh_every > 1 && build + 1 < nsteps; build += reneigh_every) {
+            const int before = build - 1;
+            const int after = build + 1;
+            double cy[5] = {
+                STEP_CY_ELEM(step_time, step_elems, before),
+                STEP_CY_ELEM(step_time, step_elems, build),
+                STEP_CY_ELEM(step_time, step_elems, after),
+                STEP_CY_ELEM(step_time_base, step_elems_base, before),
+                STEP_CY_ELEM(step_time_base, step_elems_base, after)
+            };
+
+            printf("%14d,%14d,%14.6f,%14.6f,%14.6f,%14.2f", build / reneigh_every, build, cy[0], cy[1], cy[2], (cy[2] / cy[0] - 1.0) * 100.0);
+            if(order_mode != NEIGHBOR_ORDER_NONE) {
+                printf(",%14.6f,%14.6f", cy[3], cy[4]);
+            }
+            printf("\n");
+
+            for(int k = 0; k < 5; k++) {
+                sum[k] += cy[k];
+            }
+            nintervals++;
+        }
+        #undef STEP_CY_ELEM
+
+        if(nintervals > 0) {
+            printf("%14s,%14s,%14.6f,%14.6f,%14.6f,%14.2f", "mean", "", sum[0] / nintervals, sum[1] / nintervals, sum[2] / nintervals, (sum[2] / sum[0] - 1.0) * 100.0);
+            if(order_mode != NEIGHBOR_ORDER_NONE) {
+                printf(",%14.6f,%14.6f", sum[3] / nintervals, sum[4] / nintervals);
+            }
+            printf("\n");
+        }
+
+        free(step_time);
+        free(step_time_base);
+        free(step_elems);
+        free(step_elems_base);
+        free(step_N);
+        free(step_events);
+    }
 
     #ifdef TEST
     printf("Test passed!\n");
     #endif
 
+    gatherbench_free(&bench);
+    gatherbench_free(&baseline);
+    neighbor_order_free(&ord);
+    if(generator != NULL) {
+        md_generator_free(&gen);
+    }
+
     LIKWID_MARKER_CLOSE;
     return EXIT_SUCCESS;
 }
@@ -27,6 +27,7 @@
 #include <float.h>
 #include <getopt.h>
 #include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -34,6 +35,10 @@
 #include <likwid-marker.h>
 //---
 #include <allocate.h>
+#include <aosoa.h>
+#include <cache_state.h>
+#include <gather_kernels.h>
+#include <gatherbench.h>
 #include <timing.h>
 
 #if !defined(ISA_avx2) && !defined (ISA_avx512) && !defined(ISA_sve)
@@ -44,6 +49,30 @@
 #error "TEST and ONLY_FIRST_DIMENSION options are mutually exclusive!"
 #endif
 
+#if defined(AOSOA) && defined(MEASURE_GATHER_CYCLES)
+#error "MEASURE_GATHER_CYCLES is not available for the AOSOA layout!"
+#endif
+
+#if defined(COALESCE) && (!defined(AOS) || defined(ISA_sve) || defined(MEASURE_GATHER_CYCLES))
+#error "COALESCE is only available for the AOS layout on avx2 and avx512 without MEASURE_GATHER_CYCLES!"
+#endif
+
+#if defined(CACHE_COLD) && defined(MEASURE_GATHER_CYCLES)
+#error "CACHE_STATE other than WARM is not available with MEASURE_GATHER_CYCLES!"
+#endif
+
+#if (defined(DATA_SP) || defined(DATA_HP) || defined(DATA_BF16)) && (defined(MEASURE_GATHER_CYCLES) || defined(COALESCE) || defined(MEM_TRACER))
+#error "DATA_TYPE other than DP is not available with MEASURE_GATHER_CYCLES, COALESCE and MEM_TRACER!"
+#endif
+
+#if (defined(DATA_HP) || defined(DATA_BF16) || (defined(DATA_SP) && !defined(INTRINSICS))) && defined(AOSOA)
+#error "DATA_TYPE other than DP is only available for the AOS and SOA layouts (SP also for AOSOA with INTRINSICS)!"
+#endif
+
+#if defined(INTRINSICS) && (defined(DATA_HP) || defined(DATA_BF16) || defined(MEASURE_GATHER_CYCLES))
+#error "INTRINSICS is only available for DP and SP data without MEASURE_GATHER_CYCLES!"
+#endif
+
 #define HLINE "----------------------------------------------------------------------------\n"
 
 #ifndef MIN
@@ -58,6 +87,7 @@
 
 #define ARRAY_ALIGNMENT  64
 #define SIZE  20000
+#define MAX_DIMS  16
 
 #if defined(ISA_avx512)
 #define _VL_  8
@@ -70,14 +100,29 @@
 #define ISA_STRING "avx2"
 #endif
 
-#ifdef AOS
+#if defined(AOS)
 #define GATHER gather_aos
+#define LAYOUT GB_LAYOUT_AOS
 #define LAYOUT_STRING "AoS"
+#elif defined(AOSOA)
+#define LAYOUT GB_LAYOUT_AOSOA
+#define LAYOUT_STRING "AoSoA"
 #else
 #define GATHER gather_soa
+#define LAYOUT GB_LAYOUT_SOA
 #define LAYOUT_STRING "SoA"
 #endif
 
+#if defined(DATA_SP)
+#define PRECISION GB_FLOAT
+#elif defined(DATA_HP)
+#define PRECISION GB_HALF
+#elif defined(DATA_BF16)
+#define PRECISION GB_BFLOAT16
+#else
+#define PRECISION GB_DOUBLE
+#endif
+
 #if defined(PADDING) && defined(AOS)
 #define PADDING_BYTES 1
 #else
@@ -97,33 +142,89 @@
 extern void gather_aos(double*, int*, int, double*, long int*);
 extern void gather_soa(double*, int*, int, double*, long int*);
 
+#define MAX_TAIL 64
+
+// Sweep N = 1..MAX_TAIL, where the last vector of the AoS and SoA kernels
+// is gathered with masked lanes. The overhead compares cy/elem against the
+// next multiple of the vector length, i.e. the same number of vectors.
+static int tail_sweep(const gatherbench_t* config, double freq) {
+    double cy_call[MAX_TAIL + 1];
+
+    printf("%14s,%14s,%14s,%14s,%14s,%14s,%14s\n", "N", "vectors", "tail lanes", "cy/call", "cy/elem", "cy/vector", "overhead(%)");
+    for(int N = 1; N <= MAX_TAIL; N++) {
+        gatherbench_t bench = *config;
+        gatherbench_result_t res;
+        bench.N = N;
+
+        if(!gatherbench_init(&bench)) {
+            return EXIT_FAILURE;
+        }
+
+        if(bench.N != N) {
+            fprintf(stderr, "%s %s kernel has no masked tail, N must be a multiple of %d!\n", LAYOUT_STRING, gatherbench_precision_name(PRECISION), _VL_);
+            gatherbench_free(&bench);
+            return EXIT_FAILURE;
+        }
+
+        if(!gatherbench_run(&bench, &res)) {
+            return EXIT_FAILURE;
+        }
+
+#ifdef TEST
+        if(!res.test) {
+            printf("Test failed for N = %d!\n", N);
+            return EXIT_FAILURE;
+        }
+#endif
+
+        cy_call[N] = res.time * freq / res.reps;
+        gatherbench_free(&bench);
+    }
+
+    for(int N = 1; N <= MAX_TAIL; N++) {
+        const int vectors = (N + _VL_ - 1) / _VL_;
+        const int full = vectors * _VL_;
+        const double cy_elem = cy_call[N] / N;
+        printf("%14d,%14d,%14d,%14.4f,%14.4f,%14.4f,%14.2f\n", N, vectors, N % _VL_, cy_call[N], cy_elem, cy_call[N] / vectors, (cy_elem / (cy_call[full] / full) - 1.0) * 100.0);
+    }
+
+    return EXIT_SUCCESS;
+}
+
 const char *get_mem_tracer_filename(int stride, int size) {
     static char fname[64];
     snprintf(fname, sizeof fname, "mem_tracer_%d_%d.txt", stride, size);
     return fname;
 }
 
-int log2_uint(unsigned int x) {
-    int ans = 0;
-    while(x >>= 1) { ans++; }
-    return ans;
-}
-
 int main (int argc, char** argv) {
     LIKWID_MARKER_INIT;
     LIKWID_MARKER_REGISTER("gather");
     int stride = 1;
     int cl_size = 64;
+    int dims = 3;
+    int snbytes = 0;
+    int block = _VL_;
     int opt = 0;
     double freq = 2.5;
+    double zipf = 0.0;
+    int max_N = 80000000;
+    int tails = 0;
     struct option long_opts[] = {
         {"stride", required_argument,   NULL,   's'},
         {"freq",   required_argument,   NULL,   'f'},
         {"line",   required_argument,   NULL,   'l'},
-        {"help",   required_argument,   NULL,   'h'}
+        {"dims",   required_argument,   NULL,   'd'},
+        {"width",  required_argument,   NULL,   'w'},
+        {"block",  required_argument,   NULL,   'b'},
+        {"zipf",   required_argument,   NULL,   'z'},
+        {"max",    required_argument,   NULL,   'n'},
+        {"tails",  no_argument,         NULL,   't'},
+        {"help",   no_argument,         NULL,   'h'},
+        {0, 0, 0, 0}
     };
 
-    while((opt = getopt_long(argc, argv, "s:f:l:h", long_opts, NULL)) != -1) {
+    while((opt = getopt_long(argc, argv, "s:f:l:d:w:b:z:n:th", long_opts, NULL)) != -1) {
         switch(opt) {
             case 's':
                 stride = atoi(optarg);
@@ -137,6 +238,30 @@ int main (int argc, char** argv) {
                 cl_size = atoi(optarg);
                 break;
 
+            case 'd':
+                dims = atoi(optarg);
+                break;
+
+            case 'w':
+                snbytes = atoi(optarg);
+                break;
+
+            case 'b':
+                block = atoi(optarg);
+                break;
+
+            case 'z':
+                zipf = atof(optarg);
+                break;
+
+            case 'n':
+                max_N = atoi(optarg);
+                break;
+
+            case 't':
+                tails = 1;
+                break;
+
             case 'h':
             case '?':
             default:
@@ -146,29 +271,102 @@ int main (int argc, char** argv) {
                 printf("\t-s, --stride=NUMBER   stride between two successive elements (default 1).\n");
                 printf("\t-f, --freq=REAL       CPU frequency in GHz (default 2.5).\n");
                 printf("\t-l, --line=NUMBER     cache line size in bytes (default 64).\n");
+                printf("\t-d, --dims=NUMBER     components gathered per element, 1 to %d (default 3).\n", MAX_DIMS);
+                printf("\t-w, --width=NUMBER    components per struct in AoS layout (default dims, +1 with PADDING).\n");
+                printf("\t-b, --block=NUMBER    elements per block in AoSoA layout, power of two (default %d).\n", _VL_);
+                printf("\t-z, --zipf=REAL       draw indices from a Zipf distribution with this exponent instead of using the stride.\n");
+                printf("\t-n, --max=NUMBER      largest N of the sweep (default 80000000).\n");
+                printf("\t-t, --tails           sweep the short lengths N = 1 to %d instead.\n", MAX_TAIL);
                 printf("\t-h, --help            display this help message.\n");
                 printf("\n\n");
                 return EXIT_FAILURE;
         }
     }
 
-    size_t bytesPerWord = sizeof(double);
-    const int dims = 3;
-    const int snbytes = dims + PADDING_BYTES; // bytes per element (struct), includes padding
-    #ifdef AOS
-    size_t cacheLinesPerGather = MIN(MAX(stride * _VL_ * snbytes / (cl_size / sizeof(double)), 1), _VL_);
-    #else
-    size_t cacheLinesPerGather = MIN(MAX(stride * _VL_ / (cl_size / sizeof(double)), 1), _VL_) * dims;
-    #endif
-    size_t N = SIZE;
-    double E, S;
-
-    printf("ISA,Layout,Stride,Dims,Frequency (GHz),Cache Line Size (B),Vector Width (e),Cache Lines/Gather\n");
-    printf("%s,%s,%d,%d,%f,%d,%d,%lu\n\n", ISA_STRING, LAYOUT_STRING, stride, dims, freq, cl_size, _VL_, cacheLinesPerGather);
+    if(dims < 1 || dims > MAX_DIMS) {
+        fprintf(stderr, "Number of dimensions must be between 1 and %d!\n", MAX_DIMS);
+        return EXIT_FAILURE;
+    }
+
+    if(snbytes == 0) {
+        snbytes = dims + PADDING_BYTES; // bytes per element (struct), includes padding
+    }
+
+    if(snbytes < dims) {
+        fprintf(stderr, "Struct width cannot be smaller than the number of dimensions!\n");
+        return EXIT_FAILURE;
+    }
+
+    if(block < 1 || block > AOSOA_MAX_BLOCK || (block & (block - 1)) != 0) {
+        fprintf(stderr, "Block size must be a power of two up to %d!\n", AOSOA_MAX_BLOCK);
+        return EXIT_FAILURE;
+    }
+
+#ifdef MEASURE_GATHER_CYCLES
+    if(tails) {
+        fprintf(stderr, "Short length sweep is not supported with MEASURE_GATHER_CYCLES!\n");
+        return EXIT_FAILURE;
+    }
+
+    if(dims != 3 || snbytes != 3 + PADDING_BYTES) {
+        fprintf(stderr, "MEASURE_GATHER_CYCLES is only supported for the default 3-component struct!\n");
+        return EXIT_FAILURE;
+    }
+#endif
+
+#ifdef ONLY_FIRST_DIMENSION
+    const int gathered_dims = 1;
+#else
+    const int gathered_dims = dims;
+#endif
+
+    gatherbench_t config = {
+        .kernel = GB_KERNEL_DIMS, .layout = LAYOUT, .precision = PRECISION, .index = (zipf > 0.0) ? GB_INDEX_ZIPF : GB_INDEX_STRIDE,
+        .stride = stride, .zipf = zipf, .dims = dims, .gathered_dims = gathered_dims, .width = snbytes,
+        .block = block, .cl_size = cl_size, .freq = freq,
+#ifdef CACHE_COLD
+        .cold = 1,
+#endif
+    };
+#ifdef INTRINSICS
+    // Configurations without a hand-written kernel run the generated one
+    gatherbench_t handwritten = config;
+    handwritten.N = _VL_;
+    config.generated = !gatherbench_supported(&handwritten);
+#endif
+    size_t cacheLinesPerGather = gatherbench_cache_lines_per_gather(&config);
+
+    printf("ISA,Layout,Precision,Stride,Dims,Struct Width (e),Frequency (GHz),Cache Line Size (B),Vector Width (e),Cache Lines/Gather");
+#ifdef AOSOA
+    printf(",Block (e),Cache State\n");
+    printf("%s,%s,%s,%d,%d,%d,%f,%d,%d,%lu,%d,%s\n\n", ISA_STRING, LAYOUT_STRING, gatherbench_precision_name(PRECISION), stride, dims, snbytes, freq, cl_size, _VL_, cacheLinesPerGather, block, CACHE_STATE_STRING);
+#else
+    printf(",Cache State\n");
+    printf("%s,%s,%s,%d,%d,%d,%f,%d,%d,%lu,%s\n\n", ISA_STRING, LAYOUT_STRING, gatherbench_precision_name(PRECISION), stride, dims, snbytes, freq, cl_size, _VL_, cacheLinesPerGather, CACHE_STATE_STRING);
+#endif
+    if(tails) {
+        const int ret = tail_sweep(&config, freq * 1e9);
+        LIKWID_MARKER_CLOSE;
+        return ret;
+    }
+
     printf("%14s,%14s,%14s,", "N", "Size(kB)", "cut CLs");
 
 #ifndef MEASURE_GATHER_CYCLES
     printf("%14s,%14s,%14s,%14s,%14s", "tot. time", "time/LUP(ms)", "cy/it", "cy/gather", "cy/elem");
+    printf(",%14s,%14s,%14s,%14s,%14s", "CLs touched", "pages touched", "useful GB/s", "xfer GB/s", "CL util");
+#ifdef CACHE_COLD
+    printf(",%14s,%14s,%14s", "cy/elem(c,min)", "cy/elem(c,med)", "cy/elem(c,max)");
+#endif
+#ifdef COALESCE
+    printf(",%14s,%14s,%14s", "cy/elem(coal)", "saved lanes(%)", "same CL(%)");
+#endif
+    if(PRECISION != GB_DOUBLE) {
+        printf(",%14s,%14s,%14s", "cy/elem(DP)", "Size DP(kB)", "speedup");
+    }
+#ifdef INTRINSICS
+    printf(",%14s,%14s,%14s,%14s", "cy/elem(I,u1)", "cy/elem(I,u2)", "cy/elem(I,u4)", "I(u1)/asm");
+#endif
 #else
 
 #ifdef ONLY_FIRST_DIMENSION
@@ -182,55 +380,22 @@ int main (int argc, char** argv) {
     printf("\n");
     freq = freq * 1e9;
 
-    for(int N = 512; N < 80000000; N = 1.5 * N) {
-        // Currently this only works when the array size (in elements) is multiple of the vector length (no preamble and prelude)
-        if(N % _VL_ != 0) {
-            N += _VL_ - (N % _VL_);
-        }
-
-        MEM_TRACER_INIT(stride, N);
-
-        int N_gathers_per_dim = N / _VL_;
-        int N_alloc = N * 2;
-        int N_cycles_alloc = N_gathers_per_dim * 2;
-        int cut_cl = 0;
-        double* a = (double*) allocate( ARRAY_ALIGNMENT, N_alloc * snbytes * sizeof(double) );
-        int* idx = (int*) allocate( ARRAY_ALIGNMENT, N_alloc * sizeof(int) );
-        int rep;
-        double time;
-
-#ifdef TEST
-        double* t = (double*) allocate( ARRAY_ALIGNMENT, N_alloc * dims * sizeof(double) );
-#else
-        double* t = (double*) NULL;
-#endif
+    for(int N = 512; N < 80000000 && N <= max_N; N = 1.5 * N) {
+        // Rounded up to a multiple of the vector length, the coalescing and
+        // cycle measuring kernels have no masked tail
+        gatherbench_t bench = config;
+        bench.N = N + (_VL_ - N % _VL_) % _VL_;
 
-#ifdef MEASURE_GATHER_CYCLES
-        long int* cycles = (long int*) allocate( ARRAY_ALIGNMENT, N_cycles_alloc * dims * sizeof(long int)) ;
-#else
-        long int* cycles = (long int*) NULL;
-#endif
-
-        for(int i = 0; i < N_alloc; ++i) {
-#ifdef AOS
-            a[i * snbytes + 0] = i * dims + 0;
-            a[i * snbytes + 1] = i * dims + 1;
-            a[i * snbytes + 2] = i * dims + 2;
-#else
-            a[N * 0 + i] = N * 0 + i;
-            a[N * 1 + i] = N * 1 + i;
-            a[N * 2 + i] = N * 2 + i;
-#endif
-            idx[i] = (int)(((long) i * stride) % N);
+        if(!gatherbench_init(&bench)) {
+            return EXIT_FAILURE;
         }
 
-#ifdef ONLY_FIRST_DIMENSION
-        const int gathered_dims = 1;
-#else
-        const int gathered_dims = dims;
-#endif
+        N = bench.N;
+        MEM_TRACER_INIT(stride, N);
 
 #ifdef MEM_TRACER
+        double* a = bench.a;
+        int* idx = bench.idx;
         for(int i = 0; i < N; i += _VL_) {
             for(int j = 0; j < _VL_; j++) {
                 MEM_TRACE(idx[i + j], 'R');
@@ -238,8 +403,10 @@ int main (int argc, char** argv) {
 
             for(int d = 0; d < gathered_dims; d++) {
                 for(int j = 0; j < _VL_; j++) {
-#ifdef AOS
+#if defined(AOS)
                     MEM_TRACE(a[idx[i + j] * snbytes + d], 'R');
+#elif defined(AOSOA)
+                    MEM_TRACE(a[AOSOA_IDX(idx[i + j], d, block, dims)], 'R');
 #else
                     MEM_TRACE(a[N * d + idx[i + j]], 'R');
 #endif
@@ -248,74 +415,136 @@ int main (int argc, char** argv) {
         }
 #endif
 
-#ifdef AOS
-        const int cl_shift = log2_uint((unsigned int) cl_size);
-        for(int i = 0; i < N; i++) {
-            const int first_cl = (idx[i] * snbytes * sizeof(double)) >> cl_shift;
-            const int last_cl = ((idx[i] * snbytes + gathered_dims - 1) * sizeof(double)) >> cl_shift;
-            if(first_cl != last_cl) {
-                cut_cl++;
-            }
-        }
-#endif
+#ifdef MEASURE_GATHER_CYCLES
+        int N_gathers_per_dim = N / _VL_;
+        int N_cycles_alloc = N_gathers_per_dim * 2;
+        long int* cycles = (long int*) allocate( ARRAY_ALIGNMENT, N_cycles_alloc * dims * sizeof(long int)) ;
 
-        S = getTimeStamp();
+        double S = getTimeStamp();
         for(int r = 0; r < 100; ++r) {
-            GATHER(a, idx, N, t, cycles);
+            GATHER(bench.a, bench.idx, N, bench.t, cycles);
         }
-        E = getTimeStamp();
+        double E = getTimeStamp();
 
-#ifdef MEASURE_GATHER_CYCLES
         for(int i = 0; i < N_cycles_alloc; i++) {
             cycles[i * 3 + 0] = 0;
             cycles[i * 3 + 1] = 0;
             cycles[i * 3 + 2] = 0;
         }
-#endif
 
-        rep = 100 * (0.5 / (E - S));
-        S = getTimeStamp();
+        int rep = 100 * (0.5 / (E - S));
         LIKWID_MARKER_START("gather");
         for(int r = 0; r < rep; ++r) {
-            GATHER(a, idx, N, t, cycles);
+            GATHER(bench.a, bench.idx, N, bench.t, cycles);
         }
         LIKWID_MARKER_STOP("gather");
-        E = getTimeStamp();
+        const int test = gatherbench_check(&bench);
+#else
+        gatherbench_result_t res;
+        if(!gatherbench_run(&bench, &res)) {
+            return EXIT_FAILURE;
+        }
 
-        time = E - S;
+        const int test = res.test;
+#endif
 
 #ifdef TEST
-        int test_failed = 0;
-        for(int i = 0; i < N; ++i) {
-            for(int d = 0; d < dims; ++d) {
-#ifdef AOS
-                if(t[d * N + i] != ((i * stride) % N) * dims + d) {
-#else
-                if(t[d * N + i] != d * N + ((i * stride) % N)) {
+        if(!test) {
+            printf("Test failed!\n");
+            return EXIT_FAILURE;
+        } else {
+            printf("Test passed!\n");
+        }
+#endif
+
+        const double size = N * (dims * bench.esize + sizeof(int)) / 1000.0;
+        printf("%14d,%14.2f,%14d,", N, size, bench.cut_cl);
+
+#ifndef MEASURE_GATHER_CYCLES
+        printf("%14.10f,%14.10f,%14.6f,%14.6f,%14.6f", res.time, res.time_per_lup, res.cy_per_it, res.cy_per_gather, res.cy_per_elem);
+        printf(",%14ld,%14ld,%14.2f,%14.2f,%14.4f", bench.lines, bench.pages, res.useful_gbs, res.transferred_gbs, res.line_utilization);
+
+#ifdef CACHE_COLD
+        printf(",%14.6f,%14.6f,%14.6f", res.cold_min, res.cold_med, res.cold_max);
 #endif
-                    test_failed = 1;
-                    break;
+
+#ifdef COALESCE
+        // Lanes repeating an index or a cache line of an earlier lane in the same vector
+        int* idx_c = bench.idx;
+        int saved_lanes = 0;
+        int same_cl_lanes = 0;
+        for(int i = 0; i < N; i += _VL_) {
+            for(int j = 1; j < _VL_; j++) {
+                int dup = 0;
+                int same_cl = 0;
+                for(int k = 0; k < j; k++) {
+                    dup |= idx_c[i + k] == idx_c[i + j];
+                    same_cl |= ((long) idx_c[i + k] * snbytes * sizeof(double)) / cl_size == ((long) idx_c[i + j] * snbytes * sizeof(double)) / cl_size;
                 }
+
+                saved_lanes += dup;
+                same_cl_lanes += same_cl;
             }
         }
 
-        if(test_failed) {
-            printf("Test failed!\n");
+        // Same data, kernel gathering repeated indices once
+        gatherbench_result_t res_coalesce;
+        bench.kernel = GB_KERNEL_COALESCE;
+        if(!gatherbench_run(&bench, &res_coalesce)) {
+            return EXIT_FAILURE;
+        }
+
+        printf(",%14.6f,%14.4f,%14.4f", res_coalesce.cy_per_elem, saved_lanes * 100.0 / N, same_cl_lanes * 100.0 / N);
+
+#ifdef TEST
+        if(!res_coalesce.test) {
+            printf("\nTest failed for coalesced gather!\n");
             return EXIT_FAILURE;
-        } else {
-            printf("Test passed!\n");
         }
 #endif
+#endif
+        if(PRECISION != GB_DOUBLE) {
+            // Same indices on double data
+            gatherbench_t baseline = config;
+            gatherbench_result_t res_dp;
+            baseline.N = N;
+            baseline.precision = GB_DOUBLE;
+            if(!gatherbench_init(&baseline) || !gatherbench_run(&baseline, &res_dp)) {
+                return EXIT_FAILURE;
+            }
 
-        const double size = N * (dims * sizeof(double) + sizeof(int)) / 1000.0;
-        printf("%14d,%14.2f,%14d,", N, size, cut_cl);
+            const double size_dp = N * (dims * sizeof(double) + sizeof(int)) / 1000.0;
+            printf(",%14.6f,%14.2f,%14.4f", res_dp.cy_per_elem, size_dp, res_dp.cy_per_elem / res.cy_per_elem);
+            gatherbench_free(&baseline);
+        }
 
-#ifndef MEASURE_GATHER_CYCLES
-        const double time_per_it = time * 1e6 / ((double) N * rep);
-        const double cy_per_it = time * freq * _VL_ / ((double) N * rep);
-        const double cy_per_gather = time * freq * _VL_ / ((double) N * rep * gathered_dims);
-        const double cy_per_elem = time * freq / ((double) N * rep * gathered_dims);
-        printf("%14.10f,%14.10f,%14.6f,%14.6f,%14.6f", time, time_per_it, cy_per_it, cy_per_gather, cy_per_elem);
+#ifdef INTRINSICS
+        // Same data through the generated kernels, a ratio above 1 means the
+        // compiled kernel is slower than the hand-written one
+        double cy_generated = 0.0;
+        for(int u = 0; u < GATHER_KERNEL_UNROLLS; u++) {
+            gatherbench_result_t res_gen;
+            bench.kernel = GB_KERNEL_DIMS;
+            bench.generated = 1;
+            bench.unroll = gather_kernel_unrolls[u];
+            if(!gatherbench_run(&bench, &res_gen)) {
+                return EXIT_FAILURE;
+            }
+
+#ifdef TEST
+            if(!res_gen.test) {
+                printf("\nTest failed for generated kernel with unroll %d!\n", bench.unroll);
+                return EXIT_FAILURE;
+            }
+#endif
+            printf(",%14.6f", res_gen.cy_per_elem);
+            if(u == 0) {
+                cy_generated = res_gen.cy_per_elem;
+            }
+        }
+
+        printf(",%14.4f", config.generated ? NAN : cy_generated / res.cy_per_elem);
+#endif
 #else
         double cy_min[dims];
         double cy_max[dims];
@@ -342,20 +571,12 @@ int main (int argc, char** argv) {
             snprintf(tmp_str, sizeof tmp_str, "%4.4f/%4.4f/%4.4f", cy_min[d], cy_max[d], cy_avg[d]);
             printf("%27s%c", tmp_str, (d < gathered_dims - 1) ? ',' : ' ');
         }
-#endif
-
-        printf("\n");
-        free(a);
-        free(idx);
 
-#ifdef TEST
-        free(t);
-#endif
-
-#ifdef MEASURE_GATHER_CYCLES
         free(cycles);
 #endif
 
+        printf("\n");
+        gatherbench_free(&bench);
         MEM_TRACER_END;
     }
 
@@ -0,0 +1,530 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <float.h>
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+//---
+#include <likwid-marker.h>
+//---
+#include <allocate.h>
+#include <reference.h>
+#include <timing.h>
+
+#if !defined(ISA_avx2) && !defined (ISA_avx512) && !defined(ISA_sve)
+#error "Invalid ISA macro, possible values are: avx2, avx512 and sve"
+#endif
+
+#ifndef MIN
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#endif
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+#ifndef ABS
+#define ABS(a) ((a) >= 0 ? (a) : -(a))
+#endif
+
+#define ARRAY_ALIGNMENT  64
+#define NKERNELS  2
+#define NORDERS  4
+
+#if defined(ISA_avx512)
+#define ISA_STRING "avx512"
+#elif defined(ISA_sve)
+#define ISA_STRING "sve"
+#else
+#define ISA_STRING "avx2"
+#endif
+
+// The pull loop is a sparse matrix-vector product with unit weights, the
+// kernel sums the gathered values without loading or multiplying weights
+extern void pull_sum(int nrows, int* rowptr, int* col, double* x, double* y);
+
+// In-edges in CSR, the sources of the edges into vertex v are
+// col[rowptr[v]..rowptr[v + 1] - 1]
+typedef struct {
+    int n;
+    int m;
+    int* rowptr;
+    int* col;
+    int* outdeg;
+} graph_t;
+
+// Edge list, possibly with a vertex count from the generator
+typedef struct {
+    int n;
+    long m;
+    int* src;
+    int* dst;
+} edges_t;
+
+typedef enum {
+    ORDER_INPUT = 0,
+    ORDER_SORTED,
+    ORDER_SHUFFLED,
+    ORDER_DEGREE
+} edge_order_t;
+
+static const char* order_names[NORDERS] = {"input", "sorted", "shuffled", "degree"};
+
+static void add_edge(edges_t* e, long* capacity, int src, int dst) {
+    if(e->m == *capacity) {
+        *capacity *= 2;
+        e->src = (int*) realloc(e->src, *capacity * sizeof(int));
+        e->dst = (int*) realloc(e->dst, *capacity * sizeof(int));
+    }
+
+    e->src[e->m] = src;
+    e->dst[e->m] = dst;
+    e->m++;
+    e->n = MAX(e->n, MAX(src, dst) + 1);
+}
+
+// Whitespace separated source and destination per line, lines starting with
+// # or % are comments (SNAP and Matrix Market style)
+static int read_edge_list(edges_t* e, const char* filename) {
+    char line[1024];
+    long capacity = 1024;
+    FILE* fp = fopen(filename, "r");
+
+    if(fp == NULL) {
+        fprintf(stderr, "Error: could not open edge list %s!\n", filename);
+        return 0;
+    }
+
+    e->n = 0;
+    e->m = 0;
+    e->src = (int*) malloc(capacity * sizeof(int));
+    e->dst = (int*) malloc(capacity * sizeof(int));
+
+    while(fgets(line, sizeof line, fp) != NULL) {
+        long src, dst;
+        if(line[0] == '#' || line[0] == '%') {
+            continue;
+        }
+
+        if(sscanf(line, "%ld %ld", &src, &dst) != 2) {
+            continue;
+        }
+
+        if(src < 0 || dst < 0 || src >= INT_MAX || dst >= INT_MAX) {
+            fprintf(stderr, "Invalid edge %ld %ld in %s!\n", src, dst, filename);
+            fclose(fp);
+            return 0;
+        }
+
+        add_edge(e, &capacity, (int) src, (int) dst);
+    }
+
+    fclose(fp);
+    return 1;
+}
+
+// R-MAT graph with 2^scale vertices and degree * 2^scale edges and the
+// Graph500 quadrant probabilities. Vertex labels are permuted randomly, as
+// in the Graph500 Kronecker generator, so ids carry no locality.
+static void generate_rmat(edges_t* e, int scale, int degree) {
+    const double a = 0.57, b = 0.19, c = 0.19;
+    const int n = 1 << scale;
+    int* label = (int*) malloc(n * sizeof(int));
+
+    srand48(scale);
+    for(int v = 0; v < n; v++) {
+        label[v] = v;
+    }
+
+    for(int v = n - 1; v > 0; v--) {
+        const int u = lrand48() % (v + 1);
+        const int tmp = label[v];
+        label[v] = label[u];
+        label[u] = tmp;
+    }
+
+    e->n = n;
+    e->m = (long) n * degree;
+    e->src = (int*) malloc(e->m * sizeof(int));
+    e->dst = (int*) malloc(e->m * sizeof(int));
+
+    for(long k = 0; k < e->m; k++) {
+        int src = 0, dst = 0;
+        for(int bit = scale - 1; bit >= 0; bit--) {
+            const double r = drand48();
+            if(r >= a + b + c) {
+                src |= 1 << bit;
+                dst |= 1 << bit;
+            } else if(r >= a + b) {
+                src |= 1 << bit;
+            } else if(r >= a) {
+                dst |= 1 << bit;
+            }
+        }
+
+        e->src[k] = label[src];
+        e->dst[k] = label[dst];
+    }
+
+    free(label);
+}
+
+static int* degree_keys;
+
+static int compare_degree(const void* x, const void* y) {
+    const int u = *(const int*) x;
+    const int v = *(const int*) y;
+    if(degree_keys[u] != degree_keys[v]) {
+        return (degree_keys[u] < degree_keys[v]) - (degree_keys[u] > degree_keys[v]);
+    }
+
+    return (u > v) - (u < v);
+}
+
+static int compare_int(const void* x, const void* y) {
+    const int a = *(const int*) x;
+    const int b = *(const int*) y;
+    return (a > b) - (a < b);
+}
+
+// Relabels vertices by descending out-degree, so the most gathered sources
+// share cache lines
+static void relabel_by_degree(edges_t* e) {
+    int* outdeg = (int*) calloc(e->n, sizeof(int));
+    int* order = (int*) malloc(e->n * sizeof(int));
+    int* label = (int*) malloc(e->n * sizeof(int));
+
+    for(long k = 0; k < e->m; k++) {
+        outdeg[e->src[k]]++;
+    }
+
+    for(int v = 0; v < e->n; v++) {
+        order[v] = v;
+    }
+
+    degree_keys = outdeg;
+    qsort(order, e->n, sizeof(int), compare_degree);
+    for(int v = 0; v < e->n; v++) {
+        label[order[v]] = v;
+    }
+
+    for(long k = 0; k < e->m; k++) {
+        e->src[k] = label[e->src[k]];
+        e->dst[k] = label[e->dst[k]];
+    }
+
+    free(outdeg);
+    free(order);
+    free(label);
+}
+
+// Counting sort by destination, sources keep the edge list order within a row
+static void build_graph(graph_t* g, edges_t* e, edge_order_t order) {
+    if(order == ORDER_DEGREE) {
+        relabel_by_degree(e);
+    }
+
+    g->n = e->n;
+    g->m = (int) e->m;
+    g->rowptr = (int*) allocate( ARRAY_ALIGNMENT, (g->n + 1) * sizeof(int) );
+    g->col = (int*) allocate( ARRAY_ALIGNMENT, MAX(g->m, 1) * sizeof(int) );
+    g->outdeg = (int*) allocate( ARRAY_ALIGNMENT, g->n * sizeof(int) );
+    int* fill = (int*) calloc(g->n, sizeof(int));
+
+    for(int v = 0; v <= g->n; v++) {
+        g->rowptr[v] = 0;
+    }
+
+    for(int v = 0; v < g->n; v++) {
+        g->outdeg[v] = 0;
+    }
+
+    for(int k = 0; k < g->m; k++) {
+        g->rowptr[e->dst[k] + 1]++;
+        g->outdeg[e->src[k]]++;
+    }
+
+    for(int v = 0; v < g->n; v++) {
+        g->rowptr[v + 1] += g->rowptr[v];
+    }
+
+    for(int k = 0; k < g->m; k++) {
+        const int v = e->dst[k];
+        g->col[g->rowptr[v] + fill[v]++] = e->src[k];
+    }
+
+    free(fill);
+
+    for(int v = 0; v < g->n; v++) {
+        int* row = &g->col[g->rowptr[v]];
+        const int len = g->rowptr[v + 1] - g->rowptr[v];
+
+        if(order == ORDER_SORTED || order == ORDER_DEGREE) {
+            qsort(row, len, sizeof(int), compare_int);
+        } else if(order == ORDER_SHUFFLED) {
+            for(int j = len - 1; j > 0; j--) {
+                const int k = lrand48() % (j + 1);
+                const int tmp = row[j];
+                row[j] = row[k];
+                row[k] = tmp;
+            }
+        }
+    }
+}
+
+static void pull_scalar(graph_t* g, double* contrib, double* sum) {
+    pull_sum_scalar(g->n, g->rowptr, g->col, contrib, sum);
+}
+
+static void pull_gather(graph_t* g, double* contrib, double* sum) {
+    pull_sum(g->n, g->rowptr, g->col, contrib, sum);
+}
+
+typedef void (*pull_kernel_t)(graph_t*, double*, double*);
+
+// Runs iterations of pull-based PageRank from the uniform distribution,
+// the pull loops alone take *pull_time
+static double pagerank(pull_kernel_t pull, graph_t* g, int iterations, double damping, double* rank, double* contrib, double* sum, double* pull_time) {
+    const double n = g->n;
+    double E, S, Ep, Sp;
+
+    *pull_time = 0.0;
+    for(int v = 0; v < g->n; v++) {
+        rank[v] = 1.0 / n;
+    }
+
+    S = getTimeStamp();
+    for(int it = 0; it < iterations; it++) {
+        // Vertices without out-edges spread their rank over all vertices
+        double dangling = 0.0;
+        for(int v = 0; v < g->n; v++) {
+            if(g->outdeg[v] > 0) {
+                contrib[v] = rank[v] / g->outdeg[v];
+            } else {
+                contrib[v] = 0.0;
+                dangling += rank[v];
+            }
+        }
+
+        Sp = getTimeStamp();
+        LIKWID_MARKER_START("pull");
+        pull(g, contrib, sum);
+        LIKWID_MARKER_STOP("pull");
+        Ep = getTimeStamp();
+        *pull_time += Ep - Sp;
+
+        const double base = (1.0 - damping) / n + damping * dangling / n;
+        for(int v = 0; v < g->n; v++) {
+            rank[v] = base + damping * sum[v];
+        }
+    }
+    E = getTimeStamp();
+
+    return E - S;
+}
+
+int main (int argc, char** argv) {
+    LIKWID_MARKER_INIT;
+    LIKWID_MARKER_REGISTER("pull");
+    char* edge_file = NULL;
+    char* generator = "rmat";
+    char* order_name = "input";
+    int scale = 20;
+    int degree = 16;
+    int iterations = 20;
+    int opt = 0;
+    double damping = 0.85;
+    double freq = 2.5;
+    struct option long_opts[] = {
+        {"edges",       required_argument,   NULL,   'e'},
+        {"generate",    required_argument,   NULL,   'g'},
+        {"scale",       required_argument,   NULL,   's'},
+        {"degree",      required_argument,   NULL,   'k'},
+        {"order",       required_argument,   NULL,   'o'},
+        {"iterations",  required_argument,   NULL,   'i'},
+        {"damping",     required_argument,   NULL,   'd'},
+        {"freq",        required_argument,   NULL,   'f'},
+        {"help",        no_argument,         NULL,   'h'},
+        {0, 0, 0, 0}
+    };
+
+    while((opt = getopt_long(argc, argv, "e:g:s:k:o:i:d:f:h", long_opts, NULL)) != -1) {
+        switch(opt) {
+            case 'e':
+                edge_file = optarg;
+                break;
+
+            case 'g':
+                generator = optarg;
+                break;
+
+            case 's':
+                scale = atoi(optarg);
+                break;
+
+            case 'k':
+                degree = atoi(optarg);
+                break;
+
+            case 'o':
+                order_name = optarg;
+                break;
+
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+
+            case 'd':
+                damping = atof(optarg);
+                break;
+
+            case 'f':
+                freq = atof(optarg);
+                break;
+
+            case 'h':
+            case '?':
+            default:
+                printf("Usage: %s [OPTION]...\n", argv[0]);
+                printf("Pull-based PageRank variant for gather benchmark.\n\n");
+                printf("Mandatory arguments to long options are also mandatory for short options.\n");
+                printf("\t-e, --edges=STRING      edge list to read (source and destination per line) instead of generating a graph.\n");
+                printf("\t-g, --generate=STRING   generated graph, rmat (default rmat).\n");
+                printf("\t-s, --scale=NUMBER      2^scale vertices for rmat (default 20).\n");
+                printf("\t-k, --degree=NUMBER     edges per vertex for rmat (default 16).\n");
+                printf("\t-o, --order=STRING      in-edge order: input, sorted, shuffled or degree (relabel by out-degree, then sorted) (default input).\n");
+                printf("\t-i, --iterations=NUMBER PageRank iterations per run (default 20).\n");
+                printf("\t-d, --damping=REAL      damping factor (default 0.85).\n");
+                printf("\t-f, --freq=REAL         CPU frequency in GHz (default 2.5).\n");
+                printf("\t-h, --help              display this help message.\n");
+                printf("\n\n");
+                return EXIT_FAILURE;
+        }
+    }
+
+    edge_order_t order = NORDERS;
+    for(int o = 0; o < NORDERS; o++) {
+        if(strcmp(order_name, order_names[o]) == 0) {
+            order = (edge_order_t) o;
+        }
+    }
+
+    if(order == NORDERS) {
+        fprintf(stderr, "Unknown order %s, possible values are: input, sorted, shuffled and degree\n", order_name);
+        return EXIT_FAILURE;
+    }
+
+    if(iterations < 1) {
+        fprintf(stderr, "Number of iterations must be positive!\n");
+        return EXIT_FAILURE;
+    }
+
+    edges_t e;
+    const char* graph_name = edge_file;
+
+    if(edge_file != NULL) {
+        if(!read_edge_list(&e, edge_file)) {
+            return EXIT_FAILURE;
+        }
+    } else if(strcmp(generator, "rmat") == 0) {
+        if(scale < 1 || scale > 30 || degree < 1 || (long) degree << scale > INT_MAX) {
+            fprintf(stderr, "Scale must be between 1 and 30 and the number of edges must fit into an int!\n");
+            return EXIT_FAILURE;
+        }
+
+        generate_rmat(&e, scale, degree);
+        graph_name = "rmat";
+    } else {
+        fprintf(stderr, "Unknown generator %s, possible values are: rmat\n", generator);
+        return EXIT_FAILURE;
+    }
+
+    if(e.m == 0 || e.m > INT_MAX) {
+        fprintf(stderr, "Number of edges must be between 1 and %d!\n", INT_MAX);
+        return EXIT_FAILURE;
+    }
+
+    graph_t g;
+    build_graph(&g, &e, order);
+    free(e.src);
+    free(e.dst);
+
+    int max_indeg = 0;
+    for(int v = 0; v < g.n; v++) {
+        max_indeg = MAX(max_indeg, g.rowptr[v + 1] - g.rowptr[v]);
+    }
+
+    double* rank = (double*) allocate( ARRAY_ALIGNMENT, g.n * sizeof(double) );
+    double* rank_ref = (double*) allocate( ARRAY_ALIGNMENT, g.n * sizeof(double) );
+    double* contrib = (double*) allocate( ARRAY_ALIGNMENT, g.n * sizeof(double) );
+    double* sum = (double*) allocate( ARRAY_ALIGNMENT, g.n * sizeof(double) );
+
+    printf("ISA,Graph,Vertices,Edges,Avg In-Degree,Max In-Degree,Order,Iterations,Damping,Frequency (GHz)\n");
+    printf("%s,%s,%d,%d,%f,%d,%s,%d,%f,%f\n\n", ISA_STRING, graph_name, g.n, g.m, (double) g.m / g.n, max_indeg, order_names[order], iterations, damping, freq);
+    printf("%14s,%14s,%14s,%14s,%14s,%14s\n", "Kernel", "tot. time", "pull time", "Medges/s", "cy/edge", "cy/edge(iter)");
+    freq = freq * 1e9;
+
+    const char* kernel_names[NKERNELS] = {"scalar", "gather"};
+    pull_kernel_t kernels[NKERNELS] = {pull_scalar, pull_gather};
+
+    for(int k = 0; k < NKERNELS; k++) {
+        double* result = (k == 0) ? rank_ref : rank;
+        double pull_time, pull_total = 0.0, time = 0.0;
+
+        // Whole runs are repeated for at least half a second
+        double time_once = pagerank(kernels[k], &g, iterations, damping, result, contrib, sum, &pull_time);
+        const int rep = MAX((int)(0.5 / time_once), 1);
+        for(int r = 0; r < rep; r++) {
+            time += pagerank(kernels[k], &g, iterations, damping, result, contrib, sum, &pull_time);
+            pull_total += pull_time;
+        }
+
+        // Summation order differs between the kernels
+        for(int v = 0; v < g.n; v++) {
+            if(ABS(result[v] - rank_ref[v]) > 1e-10 * rank_ref[v]) {
+                printf("Verification failed for %s kernel at vertex %d: %e != %e\n", kernel_names[k], v, result[v], rank_ref[v]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        const double edges = (double) g.m * iterations * rep;
+        printf("%14s,%14.10f,%14.10f,%14.6f,%14.6f,%14.6f\n", kernel_names[k], time, pull_total, edges / pull_total * 1e-6, pull_total * freq / edges, time * freq / edges);
+    }
+
+    free(rank);
+    free(rank_ref);
+    free(contrib);
+    free(sum);
+    free(g.rowptr);
+    free(g.col);
+    free(g.outdeg);
+
+    LIKWID_MARKER_CLOSE;
+    return EXIT_SUCCESS;
+}
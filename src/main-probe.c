@@ -0,0 +1,259 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+//---
+#include <likwid-marker.h>
+//---
+#include <allocate.h>
+#include <hash_table.h>
+#include <timing.h>
+
+#if !defined(ISA_avx2) && !defined (ISA_avx512)
+#error "Invalid ISA macro, the probe kernels are available for: avx2 and avx512"
+#endif
+
+#ifndef MIN
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#endif
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+
+#define ARRAY_ALIGNMENT  64
+#define NKERNELS  2
+
+#if defined(ISA_avx512)
+#define ISA_STRING "avx512"
+#define _VL_ 16
+#else
+#define ISA_STRING "avx2"
+#define _VL_ 8
+#endif
+
+extern void probe_open(const int* probe, int n, int* out, const int* keys, const int* vals, int shift);
+extern void probe_chained(const int* probe, int n, int* out, const int* head, const hash_node_t* nodes, int shift);
+
+static void run_scalar(hash_table_t* t, int* probe, int n, int* out) {
+    hash_table_probe(t, probe, n, out);
+}
+
+static void run_gather(hash_table_t* t, int* probe, int n, int* out) {
+    if(t->kind == HASH_OPEN) {
+        probe_open(probe, n, out, t->keys, t->vals, t->shift);
+    } else {
+        probe_chained(probe, n, out, t->head, t->nodes, t->shift);
+    }
+}
+
+typedef void (*probe_kernel_t)(hash_table_t*, int*, int, int*);
+
+typedef struct {
+    probe_kernel_t kernel;
+    hash_table_t* t;
+    int* probe;
+    int n;
+    int* out;
+} probe_run_t;
+
+static void run_probe(void* arg) {
+    probe_run_t* run = arg;
+    run->kernel(run->t, run->probe, run->n, run->out);
+}
+
+static double measure_probe(probe_kernel_t kernel, hash_table_t* t, int* probe, int n, int* out, int* rep) {
+    probe_run_t run = {kernel, t, probe, n, out};
+
+    return measureReps(run_probe, &run, "probe", rep);
+}
+
+// Distinct non-negative keys, key(i) for i >= n is never in the table. The
+// murmur3 finalizer on 31 bits is a bijection unrelated to HASH, so
+// sequential keys collide like random ones
+static int key(int i) {
+    uint32_t x = (uint32_t) i;
+    x ^= x >> 16;
+    x = (x * 0x85ebca6bu) & 0x7fffffff;
+    x ^= x >> 13;
+    x = (x * 0xc2b2ae35u) & 0x7fffffff;
+    x ^= x >> 16;
+    return (int) x;
+}
+
+int main (int argc, char** argv) {
+    LIKWID_MARKER_INIT;
+    LIKWID_MARKER_REGISTER("probe");
+    char* table_name = "open";
+    int max_keys = 1 << 22;
+    int nprobes = 1 << 20;
+    int opt = 0;
+    double load = 0.5;
+    double hit = 0.9;
+    double freq = 2.5;
+    struct option long_opts[] = {
+        {"table",   required_argument,   NULL,   't'},
+        {"load",    required_argument,   NULL,   'l'},
+        {"hit",     required_argument,   NULL,   'r'},
+        {"probes",  required_argument,   NULL,   'p'},
+        {"max",     required_argument,   NULL,   'n'},
+        {"freq",    required_argument,   NULL,   'f'},
+        {"help",    no_argument,         NULL,   'h'},
+        {0, 0, 0, 0}
+    };
+
+    while((opt = getopt_long(argc, argv, "t:l:r:p:n:f:h", long_opts, NULL)) != -1) {
+        switch(opt) {
+            case 't':
+                table_name = optarg;
+                break;
+
+            case 'l':
+                load = atof(optarg);
+                break;
+
+            case 'r':
+                hit = atof(optarg);
+                break;
+
+            case 'p':
+                nprobes = atoi(optarg);
+                break;
+
+            case 'n':
+                max_keys = atoi(optarg);
+                break;
+
+            case 'f':
+                freq = atof(optarg);
+                break;
+
+            case 'h':
+            case '?':
+            default:
+                printf("Usage: %s [OPTION]...\n", argv[0]);
+                printf("Hash-join probe variant for gather benchmark.\n\n");
+                printf("Mandatory arguments to long options are also mandatory for short options.\n");
+                printf("\t-t, --table=STRING    table kind, open (linear probing) or chained (buckets) (default open).\n");
+                printf("\t-l, --load=REAL       keys per slot (open, below 1) or per bucket (default 0.5).\n");
+                printf("\t-r, --hit=REAL        fraction of probes with a key in the table (default 0.9).\n");
+                printf("\t-p, --probes=NUMBER   probes per pass, rounded up to the vector width (default 1048576).\n");
+                printf("\t-n, --max=NUMBER      largest number of keys, the sweep doubles from 1024 (default 4194304).\n");
+                printf("\t-f, --freq=REAL       CPU frequency in GHz (default 2.5).\n");
+                printf("\t-h, --help            display this help message.\n");
+                printf("\n\n");
+                return EXIT_FAILURE;
+        }
+    }
+
+    hash_table_t table;
+    memset(&table, 0, sizeof table);
+    table.load = load;
+
+    if(strcmp(table_name, "open") == 0) {
+        table.kind = HASH_OPEN;
+    } else if(strcmp(table_name, "chained") == 0) {
+        table.kind = HASH_CHAINED;
+    } else {
+        fprintf(stderr, "Unknown table %s, possible values are: open and chained\n", table_name);
+        return EXIT_FAILURE;
+    }
+
+    if(hit < 0.0 || hit > 1.0) {
+        fprintf(stderr, "Hit fraction must be between 0 and 1!\n");
+        return EXIT_FAILURE;
+    }
+
+    if(nprobes < 1 || max_keys < 1024 || max_keys > (1 << 28)) {
+        fprintf(stderr, "Number of probes must be positive and the number of keys between 1024 and 2^28!\n");
+        return EXIT_FAILURE;
+    }
+
+    nprobes = (nprobes + _VL_ - 1) / _VL_ * _VL_;
+    int* keys = (int*) allocate( ARRAY_ALIGNMENT, max_keys * sizeof(int) );
+    int* vals = (int*) allocate( ARRAY_ALIGNMENT, max_keys * sizeof(int) );
+    int* probe = (int*) allocate( ARRAY_ALIGNMENT, nprobes * sizeof(int) );
+    int* out = (int*) allocate( ARRAY_ALIGNMENT, nprobes * sizeof(int) );
+    int* out_ref = (int*) allocate( ARRAY_ALIGNMENT, nprobes * sizeof(int) );
+
+    printf("ISA,Table,Load,Hit Fraction,Probes,Frequency (GHz)\n");
+    printf("%s,%s,%f,%f,%d,%f\n\n", ISA_STRING, table_name, load, hit, nprobes, freq);
+    printf("%14s,%14s,%14s,%14s,%14s,%14s,%14s\n", "N", "Size(kB)", "cy/probe", "Mprobes/s", "cy/probe(G)", "Mprobes/s(G)", "speedup");
+    freq = freq * 1e9;
+
+    srand48(0);
+    for(int n = 1024; n <= max_keys; n *= 2) {
+        for(int i = 0; i < n; i++) {
+            keys[i] = key(i);
+            vals[i] = i;
+        }
+
+        if(!hash_table_build(&table, keys, vals, n)) {
+            return EXIT_FAILURE;
+        }
+
+        for(int i = 0; i < nprobes; i++) {
+            const int k = lrand48() % n;
+            probe[i] = key((drand48() < hit) ? k : n + k);
+        }
+
+        probe_kernel_t kernels[NKERNELS] = {run_scalar, run_gather};
+        double cy_per_probe[NKERNELS], mprobes[NKERNELS];
+
+        for(int k = 0; k < NKERNELS; k++) {
+            int rep;
+            double time = measure_probe(kernels[k], &table, probe, nprobes, (k == 0) ? out_ref : out, &rep);
+            cy_per_probe[k] = time * freq / ((double) nprobes * rep);
+            mprobes[k] = (double) nprobes * rep / time * 1e-6;
+        }
+
+        for(int i = 0; i < nprobes; i++) {
+            if(out[i] != out_ref[i]) {
+                printf("Verification failed for N=%d at probe %d (key %d): %d != %d\n", n, i, probe[i], out[i], out_ref[i]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        printf("%14d,%14.2f,%14.4f,%14.2f,%14.4f,%14.2f,%14.2f\n",
+                n, hash_table_bytes(&table) / 1000.0,
+                cy_per_probe[0], mprobes[0], cy_per_probe[1], mprobes[1],
+                cy_per_probe[0] / cy_per_probe[1]);
+    }
+
+    hash_table_free(&table);
+    free(keys);
+    free(vals);
+    free(probe);
+    free(out);
+    free(out_ref);
+
+    LIKWID_MARKER_CLOSE;
+    return EXIT_SUCCESS;
+}
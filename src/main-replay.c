@@ -0,0 +1,472 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+//---
+#include <likwid-marker.h>
+//---
+#include <allocate.h>
+#include <aosoa.h>
+#include <timing.h>
+
+#if !defined(ISA_avx2) && !defined (ISA_avx512) && !defined(ISA_sve)
+#error "Invalid ISA macro, possible values are: avx2, avx512 and sve"
+#endif
+
+#ifndef MIN
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#endif
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+
+#define ARRAY_ALIGNMENT  64
+#define MAX_DIMS  16
+#define CHUNK  (1 << 20)
+
+#if defined(ISA_avx512)
+#define _VL_  8
+#define ISA_STRING "avx512"
+#elif defined(ISA_sve)
+#define _VL_  2
+#define ISA_STRING "sve"
+#else
+#define _VL_  4
+#define ISA_STRING "avx2"
+#endif
+
+#if defined(AOS)
+#define GATHER_DIMS gather_aos_dims
+#define LAYOUT_STRING "AoS"
+#elif defined(AOSOA)
+#define GATHER_DIMS gather_aosoa_dims
+#define LAYOUT_STRING "AoSoA"
+#else
+#define GATHER_DIMS gather_soa_dims
+#define LAYOUT_STRING "SoA"
+#endif
+
+#if defined(PADDING) && defined(AOS)
+#define PADDING_BYTES 1
+#else
+#define PADDING_BYTES 0
+#endif
+
+#ifdef TEST
+extern void gather(double*, int*, int, double*);
+#else
+extern void gather(double*, int*, int);
+#endif
+
+// Generated kernels gathering D = 1..MAX_DIMS components, indexed by D - 1
+typedef void (*gather_dims_t)(double*, int*, int, double*, int);
+extern gather_dims_t gather_aos_dims[MAX_DIMS];
+extern gather_dims_t gather_soa_dims[MAX_DIMS];
+extern gather_dims_t gather_aosoa_dims[MAX_DIMS];
+
+// Raw little-endian int32 or int64 index stream, optionally preceded by the
+// data array length as int64
+typedef struct {
+    void* map;
+    size_t map_bytes;
+    const char* data;
+    int wide;
+    long count;
+    long length;
+} trace_t;
+
+static int open_trace(trace_t* tr, const char* filename, int wide, int header) {
+    struct stat st;
+    const size_t esize = wide ? sizeof(int64_t) : sizeof(int32_t);
+    const size_t offset = header ? sizeof(int64_t) : 0;
+    int fd = open(filename, O_RDONLY);
+
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Could not open index file %s!\n", filename);
+        return 0;
+    }
+
+    if((size_t) st.st_size <= offset || (st.st_size - offset) % esize != 0) {
+        fprintf(stderr, "Size of %s does not match its index type!\n", filename);
+        close(fd);
+        return 0;
+    }
+
+    tr->map_bytes = st.st_size;
+    tr->map = mmap(NULL, tr->map_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(tr->map == MAP_FAILED) {
+        fprintf(stderr, "Could not map index file %s!\n", filename);
+        return 0;
+    }
+
+    madvise(tr->map, tr->map_bytes, MADV_SEQUENTIAL);
+    tr->data = (const char*) tr->map + offset;
+    tr->wide = wide;
+    tr->length = header ? (long) *(const int64_t*) tr->map : 0;
+    // Kernels work on full vectors, a trailing partial vector is dropped
+    tr->count = (tr->map_bytes - offset) / esize / _VL_ * _VL_;
+    return 1;
+}
+
+static long trace_index(trace_t* tr, long i) {
+    return tr->wide ? (long) ((const int64_t*) tr->data)[i] : (long) ((const int32_t*) tr->data)[i];
+}
+
+// int32 traces are used in place, int64 traces are narrowed into buf
+static int* load_chunk(trace_t* tr, long offset, int n, int* buf) {
+    if(!tr->wide) {
+        return (int*) tr->data + offset;
+    }
+
+    const int64_t* src = (const int64_t*) tr->data + offset;
+    for(int i = 0; i < n; i++) {
+        buf[i] = (int) src[i];
+    }
+
+    return buf;
+}
+
+int main (int argc, char** argv) {
+    LIKWID_MARKER_INIT;
+    LIKWID_MARKER_REGISTER("gather");
+    char* filename = NULL;
+    int type = 32;
+    int header = 0;
+    int cl_size = 64;
+    int dims = 3;
+    int snbytes = 0;
+    int block = _VL_;
+    int chunk = CHUNK;
+    int opt = 0;
+    double freq = 2.5;
+    struct option long_opts[] = {
+        {"index",  required_argument,   NULL,   'i'},
+        {"type",   required_argument,   NULL,   't'},
+        {"header", no_argument,         NULL,   'H'},
+        {"freq",   required_argument,   NULL,   'f'},
+        {"line",   required_argument,   NULL,   'l'},
+        {"dims",   required_argument,   NULL,   'd'},
+        {"width",  required_argument,   NULL,   'w'},
+        {"block",  required_argument,   NULL,   'b'},
+        {"chunk",  required_argument,   NULL,   'c'},
+        {"help",   no_argument,         NULL,   'h'},
+        {0, 0, 0, 0}
+    };
+
+    while((opt = getopt_long(argc, argv, "i:t:Hf:l:d:w:b:c:h", long_opts, NULL)) != -1) {
+        switch(opt) {
+            case 'i':
+                filename = optarg;
+                break;
+
+            case 't':
+                type = atoi(optarg);
+                break;
+
+            case 'H':
+                header = 1;
+                break;
+
+            case 'f':
+                freq = atof(optarg);
+                break;
+
+            case 'l':
+                cl_size = atoi(optarg);
+                break;
+
+            case 'd':
+                dims = atoi(optarg);
+                break;
+
+            case 'w':
+                snbytes = atoi(optarg);
+                break;
+
+            case 'b':
+                block = atoi(optarg);
+                break;
+
+            case 'c':
+                chunk = atoi(optarg);
+                break;
+
+            case 'h':
+            case '?':
+            default:
+                printf("Usage: %s -i FILE [OPTION]...\n", argv[0]);
+                printf("Index trace replay variant for gather benchmark.\n\n");
+                printf("Mandatory arguments to long options are also mandatory for short options.\n");
+                printf("\t-i, --index=STRING    raw binary index file.\n");
+                printf("\t-t, --type=NUMBER     index width in bits, 32 or 64 (default 32).\n");
+                printf("\t-H, --header          file starts with the data array length as int64 (default max index + 1).\n");
+                printf("\t-f, --freq=REAL       CPU frequency in GHz (default 2.5).\n");
+                printf("\t-l, --line=NUMBER     cache line size in bytes (default 64).\n");
+                printf("\t-d, --dims=NUMBER     components gathered per element, 1 to %d (default 3).\n", MAX_DIMS);
+                printf("\t-w, --width=NUMBER    doubles per struct in AoS layout (default dims, +1 with PADDING).\n");
+                printf("\t-b, --block=NUMBER    elements per block in AoSoA layout, power of two (default %d).\n", _VL_);
+                printf("\t-c, --chunk=NUMBER    indices passed to the kernel per call (default %d).\n", CHUNK);
+                printf("\t-h, --help            display this help message.\n");
+                printf("\n\n");
+                return EXIT_FAILURE;
+        }
+    }
+
+    if(filename == NULL) {
+        fprintf(stderr, "No index file given, see %s --help\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if(type != 32 && type != 64) {
+        fprintf(stderr, "Index type must be 32 or 64!\n");
+        return EXIT_FAILURE;
+    }
+
+    if(dims < 1 || dims > MAX_DIMS) {
+        fprintf(stderr, "Number of dimensions must be between 1 and %d!\n", MAX_DIMS);
+        return EXIT_FAILURE;
+    }
+
+    if(snbytes == 0) {
+        snbytes = dims + PADDING_BYTES; // bytes per element (struct), includes padding
+    }
+
+    if(snbytes < dims) {
+        fprintf(stderr, "Struct width cannot be smaller than the number of dimensions!\n");
+        return EXIT_FAILURE;
+    }
+
+    if(block < 1 || block > AOSOA_MAX_BLOCK || (block & (block - 1)) != 0) {
+        fprintf(stderr, "Block size must be a power of two up to %d!\n", AOSOA_MAX_BLOCK);
+        return EXIT_FAILURE;
+    }
+
+    chunk = chunk / _VL_ * _VL_;
+    if(chunk < _VL_) {
+        fprintf(stderr, "Chunk must hold at least %d indices!\n", _VL_);
+        return EXIT_FAILURE;
+    }
+
+    trace_t tr;
+    if(!open_trace(&tr, filename, type == 64, header)) {
+        return EXIT_FAILURE;
+    }
+
+    if(tr.count == 0) {
+        fprintf(stderr, "%s holds less than one vector of indices!\n", filename);
+        return EXIT_FAILURE;
+    }
+
+    long max_idx = 0;
+    for(long i = 0; i < tr.count; i++) {
+        const long j = trace_index(&tr, i);
+        if(j < 0 || (header && j >= tr.length)) {
+            fprintf(stderr, "Index %ld at position %ld is out of range!\n", j, i);
+            return EXIT_FAILURE;
+        }
+
+        max_idx = MAX(max_idx, j);
+    }
+
+    if(!header) {
+        tr.length = max_idx + 1;
+    }
+
+    // Kernels scale 32-bit indices by the struct width
+    if((tr.length + block) * MAX(snbytes, dims) > INT_MAX) {
+        fprintf(stderr, "Data array of %ld elements is too large for 32-bit gather offsets!\n", tr.length);
+        return EXIT_FAILURE;
+    }
+
+    const long N = tr.length;
+    chunk = MIN((long) chunk, tr.count);
+    double* a1 = (double*) allocate( ARRAY_ALIGNMENT, N * sizeof(double) );
+    double* a = (double*) allocate( ARRAY_ALIGNMENT, (N + block) * snbytes * sizeof(double) );
+    int* buf = (int*) allocate( ARRAY_ALIGNMENT, chunk * sizeof(int) );
+#ifdef TEST
+    double* t = (double*) allocate( ARRAY_ALIGNMENT, (long) chunk * dims * sizeof(double) );
+#else
+    double* t = (double*) NULL;
+#endif
+
+    for(long i = 0; i < N; ++i) {
+        a1[i] = i;
+        for(int d = 0; d < dims; d++) {
+#if defined(AOS)
+            a[i * snbytes + d] = i * dims + d;
+#elif defined(AOSOA)
+            a[AOSOA_IDX(i, d, block, dims)] = i * dims + d;
+#else
+            a[N * d + i] = N * d + i;
+#endif
+        }
+    }
+
+#if defined(AOS)
+    const int layout_arg = snbytes;
+#elif defined(AOSOA)
+    const int layout_arg = AOSOA_ARG(block, dims);
+#else
+    const int layout_arg = N;
+#endif
+    gather_dims_t gather_dims = GATHER_DIMS[dims - 1];
+
+    // Structs crossing a cache line and distinct lines per gathered vector
+    long cut_cl = 0;
+    long lines_plain = 0;
+    long lines_layout = 0;
+    for(long i = 0; i < tr.count; i += _VL_) {
+        long seen[_VL_ * MAX_DIMS];
+        int nseen = 0;
+        int nseen_plain = 0;
+
+        for(int j = 0; j < _VL_; j++) {
+            const long idx = trace_index(&tr, i + j);
+            const long cl = idx * sizeof(double) / cl_size;
+            int k = 0;
+            while(k < nseen_plain && seen[k] != cl) { k++; }
+            if(k == nseen_plain) {
+                seen[nseen_plain++] = cl;
+            }
+        }
+
+        lines_plain += nseen_plain;
+
+        for(int j = 0; j < _VL_; j++) {
+            const long idx = trace_index(&tr, i + j);
+#if defined(AOS)
+            if((idx * snbytes * sizeof(double)) / cl_size != ((idx * snbytes + dims - 1) * sizeof(double)) / cl_size) {
+                cut_cl++;
+            }
+#endif
+            for(int d = 0; d < dims; d++) {
+#if defined(AOS)
+                const long cl = (idx * snbytes + d) * sizeof(double) / cl_size;
+#elif defined(AOSOA)
+                const long cl = AOSOA_IDX(idx, d, (long) block, dims) * sizeof(double) / cl_size;
+#else
+                const long cl = (N * d + idx) * sizeof(double) / cl_size;
+#endif
+                int k = 0;
+                while(k < nseen && seen[k] != cl) { k++; }
+                if(k == nseen) {
+                    seen[nseen++] = cl;
+                }
+            }
+        }
+
+        lines_layout += nseen;
+    }
+
+#ifdef AOSOA
+    printf("ISA,Layout,Trace,Index Type,Indices,Data Length,Dims,Struct Width (e),Frequency (GHz),Cache Line Size (B),Vector Width (e),Block (e)\n");
+    printf("%s,%s,%s,int%d,%ld,%ld,%d,%d,%f,%d,%d,%d\n\n", ISA_STRING, LAYOUT_STRING, filename, type, tr.count, N, dims, snbytes, freq, cl_size, _VL_, block);
+#else
+    printf("ISA,Layout,Trace,Index Type,Indices,Data Length,Dims,Struct Width (e),Frequency (GHz),Cache Line Size (B),Vector Width (e)\n");
+    printf("%s,%s,%s,int%d,%ld,%ld,%d,%d,%f,%d,%d\n\n", ISA_STRING, LAYOUT_STRING, filename, type, tr.count, N, dims, snbytes, freq, cl_size, _VL_);
+#endif
+    printf("%14s,%14s,%14s,%14s,%14s,%14s,%14s\n", "Kernel", "tot. time", "passes", "cut CLs", "CLs/gather", "cy/gather", "cy/elem");
+    freq = freq * 1e9;
+
+    for(int k = 0; k < 2; k++) {
+        const int kernel_dims = (k == 0) ? 1 : dims;
+        double time = 0.0;
+        int passes = 0;
+
+        // One untimed pass to warm up, then whole passes until 0.5 s are reached
+        for(int pass = 0; pass == 0 || time < 0.5; pass++) {
+            for(long off = 0; off < tr.count; off += chunk) {
+                const int n = MIN((long) chunk, tr.count - off);
+                int* idx = load_chunk(&tr, off, n, buf);
+                double E, S;
+
+                S = getTimeStamp();
+                LIKWID_MARKER_START("gather");
+                if(k == 0) {
+#ifdef TEST
+                    gather(a1, idx, n, t);
+#else
+                    gather(a1, idx, n);
+#endif
+                } else {
+                    gather_dims(a, idx, n, t, layout_arg);
+                }
+                LIKWID_MARKER_STOP("gather");
+                E = getTimeStamp();
+
+                if(pass > 0) {
+                    time += E - S;
+                }
+
+#ifdef TEST
+                for(int i = 0; i < n; i++) {
+                    for(int d = 0; d < kernel_dims; d++) {
+#if defined(AOS) || defined(AOSOA)
+                        const double expected = (k == 0) ? idx[i] : (double) idx[i] * dims + d;
+#else
+                        const double expected = (k == 0) ? idx[i] : (double) N * d + idx[i];
+#endif
+                        if(t[(long) d * n + i] != expected) {
+                            printf("Test failed for %s kernel at index %ld!\n", (k == 0) ? "gather" : LAYOUT_STRING, off + i);
+                            return EXIT_FAILURE;
+                        }
+                    }
+                }
+#endif
+            }
+
+            passes = pass;
+        }
+
+        const double elems = (double) tr.count * passes * kernel_dims;
+        const double cls_per_gather = (k == 0) ? (double) lines_plain * _VL_ / tr.count : (double) lines_layout * _VL_ / ((double) tr.count * dims);
+        printf("%14s,%14.10f,%14d,%14ld,%14.6f,%14.6f,%14.6f\n", (k == 0) ? "gather" : LAYOUT_STRING, time, passes,
+               (k == 0) ? 0 : cut_cl, cls_per_gather, time * freq * _VL_ / elems, time * freq / elems);
+    }
+
+#ifdef TEST
+    printf("Test passed!\n");
+    free(t);
+#endif
+
+    free(a1);
+    free(a);
+    free(buf);
+    munmap(tr.map, tr.map_bytes);
+
+    LIKWID_MARKER_CLOSE;
+    return EXIT_SUCCESS;
+}
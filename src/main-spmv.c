@@ -0,0 +1,533 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2021 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <float.h>
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+//---
+#include <likwid-marker.h>
+//---
+#include <allocate.h>
+#include <reference.h>
+#include <timing.h>
+
+#if !defined(ISA_avx2) && !defined (ISA_avx512) && !defined(ISA_sve)
+#error "Invalid ISA macro, possible values are: avx2, avx512 and sve"
+#endif
+
+#ifndef MIN
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#endif
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+#ifndef ABS
+#define ABS(a) ((a) >= 0 ? (a) : -(a))
+#endif
+
+#define ARRAY_ALIGNMENT  64
+#define NKERNELS  3
+
+#if defined(ISA_avx512)
+#define ISA_STRING "avx512"
+#elif defined(ISA_sve)
+#define ISA_STRING "sve"
+#else
+#define ISA_STRING "avx2"
+#endif
+
+extern void spmv_csr(int nrows, int* rowptr, int* col, double* val, double* x, double* y);
+extern void spmv_sell(int nchunks, int* chunkptr, int* col, double* val, double* x, double* y);
+extern int spmv_sell_width();
+
+typedef struct {
+    int nrows;
+    int ncols;
+    int nnz;
+    // CSR
+    int* rowptr;
+    int* col;
+    double* val;
+    // SELL-C-sigma, rows are sorted by length inside windows of sigma rows
+    int C;
+    int sigma;
+    int nchunks;
+    int nnz_sell;
+    int* chunkptr;
+    int* sell_col;
+    double* sell_val;
+    int* perm;
+    double* y_sell;
+} spmv_matrix_t;
+
+typedef struct {
+    int row;
+    int col;
+    double val;
+} coo_entry_t;
+
+static int compare_coo(const void* x, const void* y) {
+    const coo_entry_t* ex = (const coo_entry_t*) x;
+    const coo_entry_t* ey = (const coo_entry_t*) y;
+    if(ex->row != ey->row) {
+        return (ex->row > ey->row) - (ex->row < ey->row);
+    }
+
+    return (ex->col > ey->col) - (ex->col < ey->col);
+}
+
+static void coo_to_csr(spmv_matrix_t* m, coo_entry_t* coo, int nnz) {
+    qsort(coo, nnz, sizeof(coo_entry_t), compare_coo);
+    m->nnz = nnz;
+    m->rowptr = (int*) allocate( ARRAY_ALIGNMENT, (m->nrows + 1) * sizeof(int) );
+    m->col = (int*) allocate( ARRAY_ALIGNMENT, MAX(nnz, 1) * sizeof(int) );
+    m->val = (double*) allocate( ARRAY_ALIGNMENT, MAX(nnz, 1) * sizeof(double) );
+
+    for(int i = 0; i <= m->nrows; i++) {
+        m->rowptr[i] = 0;
+    }
+
+    for(int j = 0; j < nnz; j++) {
+        m->rowptr[coo[j].row + 1]++;
+        m->col[j] = coo[j].col;
+        m->val[j] = coo[j].val;
+    }
+
+    for(int i = 0; i < m->nrows; i++) {
+        m->rowptr[i + 1] += m->rowptr[i];
+    }
+}
+
+// Coordinate format with real, integer or pattern entries, general, symmetric
+// or skew-symmetric
+static int read_matrix_market(spmv_matrix_t* m, const char* filename) {
+    char line[1024];
+    char object[64], format[64], field[64], symmetry[64];
+    FILE* fp = fopen(filename, "r");
+
+    if(fp == NULL) {
+        fprintf(stderr, "Could not open matrix file %s!\n", filename);
+        return 0;
+    }
+
+    if(fgets(line, sizeof line, fp) == NULL ||
+       sscanf(line, "%%%%MatrixMarket %63s %63s %63s %63s", object, format, field, symmetry) != 4 ||
+       strcmp(object, "matrix") != 0 || strcmp(format, "coordinate") != 0) {
+        fprintf(stderr, "%s is not a Matrix Market coordinate file!\n", filename);
+        fclose(fp);
+        return 0;
+    }
+
+    const int pattern = strcmp(field, "pattern") == 0;
+    const int skew = strcmp(symmetry, "skew-symmetric") == 0;
+    const int symmetric = skew || strcmp(symmetry, "symmetric") == 0;
+    if(strcmp(field, "complex") == 0) {
+        fprintf(stderr, "Complex matrices are not supported!\n");
+        fclose(fp);
+        return 0;
+    }
+
+    if(!symmetric && strcmp(symmetry, "general") != 0) {
+        fprintf(stderr, "Unsupported symmetry %s, possible values are: general, symmetric and skew-symmetric\n", symmetry);
+        fclose(fp);
+        return 0;
+    }
+
+    do {
+        if(fgets(line, sizeof line, fp) == NULL) {
+            fprintf(stderr, "Missing size line in %s!\n", filename);
+            fclose(fp);
+            return 0;
+        }
+    } while(line[0] == '%');
+
+    int entries;
+    if(sscanf(line, "%d %d %d", &m->nrows, &m->ncols, &entries) != 3) {
+        fprintf(stderr, "Invalid size line in %s!\n", filename);
+        fclose(fp);
+        return 0;
+    }
+
+    if(m->nrows < 0 || m->ncols < 0 || entries < 0 || entries > INT_MAX / (symmetric + 1) || (symmetric && m->nrows != m->ncols)) {
+        fprintf(stderr, "Invalid matrix size in %s!\n", filename);
+        fclose(fp);
+        return 0;
+    }
+
+    coo_entry_t* coo = (coo_entry_t*) allocate( ARRAY_ALIGNMENT, MAX(entries * (symmetric + 1), 1) * sizeof(coo_entry_t) );
+    int nnz = 0;
+    for(int e = 0; e < entries; e++) {
+        int r, c;
+        double v = 1.0;
+        int n = pattern ? fscanf(fp, "%d %d", &r, &c) : fscanf(fp, "%d %d %lf", &r, &c, &v);
+        if(n != 3 - pattern) {
+            fprintf(stderr, "Unexpected end of %s after %d entries!\n", filename, e);
+            free(coo);
+            fclose(fp);
+            return 0;
+        }
+
+        if(r < 1 || r > m->nrows || c < 1 || c > m->ncols) {
+            fprintf(stderr, "Entry (%d, %d) outside of the %d x %d matrix in %s!\n", r, c, m->nrows, m->ncols, filename);
+            free(coo);
+            fclose(fp);
+            return 0;
+        }
+
+        coo[nnz++] = (coo_entry_t) { r - 1, c - 1, v };
+        if(symmetric && r != c) {
+            coo[nnz++] = (coo_entry_t) { c - 1, r - 1, skew ? -v : v };
+        }
+    }
+
+    fclose(fp);
+    coo_to_csr(m, coo, nnz);
+    free(coo);
+    return 1;
+}
+
+// 5-point Laplacian on an n x n grid
+static void generate_stencil(spmv_matrix_t* m, int n) {
+    m->nrows = n * n;
+    m->ncols = n * n;
+    coo_entry_t* coo = (coo_entry_t*) allocate( ARRAY_ALIGNMENT, 5 * m->nrows * sizeof(coo_entry_t) );
+    int nnz = 0;
+
+    for(int i = 0; i < n; i++) {
+        for(int j = 0; j < n; j++) {
+            const int row = i * n + j;
+            if(i > 0)     { coo[nnz++] = (coo_entry_t) { row, row - n, -1.0 }; }
+            if(j > 0)     { coo[nnz++] = (coo_entry_t) { row, row - 1, -1.0 }; }
+            coo[nnz++] = (coo_entry_t) { row, row, 4.0 };
+            if(j < n - 1) { coo[nnz++] = (coo_entry_t) { row, row + 1, -1.0 }; }
+            if(i < n - 1) { coo[nnz++] = (coo_entry_t) { row, row + n, -1.0 }; }
+        }
+    }
+
+    coo_to_csr(m, coo, nnz);
+    free(coo);
+}
+
+// n x n matrix with k uniformly random columns per row
+static void generate_random(spmv_matrix_t* m, int n, int k) {
+    m->nrows = n;
+    m->ncols = n;
+    coo_entry_t* coo = (coo_entry_t*) allocate( ARRAY_ALIGNMENT, MAX((long) n * k, 1) * sizeof(coo_entry_t) );
+    int nnz = 0;
+
+    srand48(n);
+    for(int i = 0; i < n; i++) {
+        for(int j = 0; j < k; j++) {
+            coo[nnz++] = (coo_entry_t) { i, (int)(lrand48() % n), drand48() };
+        }
+    }
+
+    coo_to_csr(m, coo, nnz);
+    free(coo);
+}
+
+static int* sell_lengths;
+
+static int compare_sell_rows(const void* x, const void* y) {
+    const int lx = sell_lengths[*(const int*) x];
+    const int ly = sell_lengths[*(const int*) y];
+    return (ly > lx) - (ly < lx);
+}
+
+static void build_sell(spmv_matrix_t* m, int C, int sigma) {
+    const int nrows_pad = (m->nrows + C - 1) / C * C;
+    m->C = C;
+    m->sigma = sigma;
+    m->nchunks = nrows_pad / C;
+    m->perm = (int*) allocate( ARRAY_ALIGNMENT, nrows_pad * sizeof(int) );
+    m->chunkptr = (int*) allocate( ARRAY_ALIGNMENT, (m->nchunks + 1) * sizeof(int) );
+    m->y_sell = (double*) allocate( ARRAY_ALIGNMENT, nrows_pad * sizeof(double) );
+
+    sell_lengths = (int*) allocate( ARRAY_ALIGNMENT, nrows_pad * sizeof(int) );
+    for(int i = 0; i < nrows_pad; i++) {
+        m->perm[i] = i;
+        sell_lengths[i] = (i < m->nrows) ? m->rowptr[i + 1] - m->rowptr[i] : 0;
+    }
+
+    for(int i = 0; i < nrows_pad; i += sigma) {
+        qsort(&m->perm[i], MIN(sigma, nrows_pad - i), sizeof(int), compare_sell_rows);
+    }
+
+    m->chunkptr[0] = 0;
+    for(int c = 0; c < m->nchunks; c++) {
+        int len = 0;
+        for(int l = 0; l < C; l++) {
+            len = MAX(len, sell_lengths[m->perm[c * C + l]]);
+        }
+
+        m->chunkptr[c + 1] = m->chunkptr[c] + len * C;
+    }
+
+    m->nnz_sell = m->chunkptr[m->nchunks];
+    m->sell_col = (int*) allocate( ARRAY_ALIGNMENT, MAX(m->nnz_sell, 1) * sizeof(int) );
+    m->sell_val = (double*) allocate( ARRAY_ALIGNMENT, MAX(m->nnz_sell, 1) * sizeof(double) );
+
+    // Padding entries multiply x[0] by zero
+    for(int c = 0; c < m->nchunks; c++) {
+        const int len = (m->chunkptr[c + 1] - m->chunkptr[c]) / C;
+        for(int l = 0; l < C; l++) {
+            const int row = m->perm[c * C + l];
+            for(int k = 0; k < len; k++) {
+                const int s = m->chunkptr[c] + k * C + l;
+                if(k < sell_lengths[row]) {
+                    m->sell_col[s] = m->col[m->rowptr[row] + k];
+                    m->sell_val[s] = m->val[m->rowptr[row] + k];
+                } else {
+                    m->sell_col[s] = 0;
+                    m->sell_val[s] = 0.0;
+                }
+            }
+        }
+    }
+
+    free(sell_lengths);
+}
+
+static void run_scalar(spmv_matrix_t* m, double* x, double* y) {
+    spmv_csr_scalar(m->nrows, m->rowptr, m->col, m->val, x, y);
+}
+
+static void run_csr(spmv_matrix_t* m, double* x, double* y) {
+    spmv_csr(m->nrows, m->rowptr, m->col, m->val, x, y);
+}
+
+// y has to hold nchunks * C elements, the result is in chunk order
+static void run_sell(spmv_matrix_t* m, double* x, double* y) {
+    spmv_sell(m->nchunks, m->chunkptr, m->sell_col, m->sell_val, x, y);
+}
+
+// Permute y from the SELL kernel back to row order
+static void sell_result(spmv_matrix_t* m, double* y) {
+    memcpy(m->y_sell, y, (size_t) m->nchunks * m->C * sizeof(double));
+    for(int i = 0; i < m->nchunks * m->C; i++) {
+        if(m->perm[i] < m->nrows) {
+            y[m->perm[i]] = m->y_sell[i];
+        }
+    }
+}
+
+typedef void (*spmv_kernel_t)(spmv_matrix_t*, double*, double*);
+
+typedef struct {
+    spmv_kernel_t kernel;
+    spmv_matrix_t* m;
+    double* x;
+    double* y;
+} spmv_run_t;
+
+static void run_spmv(void* arg) {
+    spmv_run_t* run = arg;
+    run->kernel(run->m, run->x, run->y);
+}
+
+static double measure_spmv(spmv_kernel_t kernel, spmv_matrix_t* m, double* x, double* y, int* rep) {
+    spmv_run_t run = {kernel, m, x, y};
+
+    return measureReps(run_spmv, &run, "spmv", rep);
+}
+
+int main (int argc, char** argv) {
+    LIKWID_MARKER_INIT;
+    LIKWID_MARKER_REGISTER("spmv");
+    char* matrix_file = NULL;
+    char* generator = "stencil";
+    int size = 0;
+    int nnz_per_row = 16;
+    int sigma = 0;
+    int opt = 0;
+    double freq = 2.5;
+    struct option long_opts[] = {
+        {"matrix",    required_argument,   NULL,   'm'},
+        {"generate",  required_argument,   NULL,   'g'},
+        {"size",      required_argument,   NULL,   'n'},
+        {"nnz",       required_argument,   NULL,   'k'},
+        {"sigma",     required_argument,   NULL,   'c'},
+        {"freq",      required_argument,   NULL,   'f'},
+        {"help",      no_argument,         NULL,   'h'},
+        {0, 0, 0, 0}
+    };
+
+    while((opt = getopt_long(argc, argv, "m:g:n:k:c:f:h", long_opts, NULL)) != -1) {
+        switch(opt) {
+            case 'm':
+                matrix_file = optarg;
+                break;
+
+            case 'g':
+                generator = optarg;
+                break;
+
+            case 'n':
+                size = atoi(optarg);
+                break;
+
+            case 'k':
+                nnz_per_row = atoi(optarg);
+                break;
+
+            case 'c':
+                sigma = atoi(optarg);
+                break;
+
+            case 'f':
+                freq = atof(optarg);
+                break;
+
+            case 'h':
+            case '?':
+            default:
+                printf("Usage: %s [OPTION]...\n", argv[0]);
+                printf("Sparse matrix-vector product variant for gather benchmark.\n\n");
+                printf("Mandatory arguments to long options are also mandatory for short options.\n");
+                printf("\t-m, --matrix=STRING   Matrix Market file to read instead of generating a matrix.\n");
+                printf("\t-g, --generate=STRING generated matrix, stencil or random (default stencil).\n");
+                printf("\t-n, --size=NUMBER     grid points per dimension for stencil (default 1000), rows for random (default 1000000).\n");
+                printf("\t-k, --nnz=NUMBER      nonzeros per row for random (default 16).\n");
+                printf("\t-c, --sigma=NUMBER    sorting scope of SELL-C-sigma in rows (default 32 * C).\n");
+                printf("\t-f, --freq=REAL       CPU frequency in GHz (default 2.5).\n");
+                printf("\t-h, --help            display this help message.\n");
+                printf("\n\n");
+                return EXIT_FAILURE;
+        }
+    }
+
+    spmv_matrix_t m;
+    const char* matrix_name = matrix_file;
+
+    if(matrix_file != NULL) {
+        if(!read_matrix_market(&m, matrix_file)) {
+            return EXIT_FAILURE;
+        }
+    } else if(strcmp(generator, "stencil") == 0) {
+        generate_stencil(&m, size > 0 ? size : 1000);
+        matrix_name = "stencil";
+    } else if(strcmp(generator, "random") == 0) {
+        if(nnz_per_row < 1) {
+            fprintf(stderr, "Number of nonzeros per row must be positive!\n");
+            return EXIT_FAILURE;
+        }
+
+        generate_random(&m, size > 0 ? size : 1000000, nnz_per_row);
+        matrix_name = "random";
+    } else {
+        fprintf(stderr, "Unknown generator %s, possible values are: stencil and random\n", generator);
+        return EXIT_FAILURE;
+    }
+
+    if(m.nnz == 0) {
+        fprintf(stderr, "Matrix has no nonzeros!\n");
+        return EXIT_FAILURE;
+    }
+
+    const int C = spmv_sell_width();
+    if(sigma < 1) {
+        sigma = 32 * C;
+    }
+
+    build_sell(&m, C, sigma);
+
+    double* x = (double*) allocate( ARRAY_ALIGNMENT, m.ncols * sizeof(double) );
+    double* y = (double*) allocate( ARRAY_ALIGNMENT, MAX(m.nrows, m.nchunks * C) * sizeof(double) );
+    double* y_ref = (double*) allocate( ARRAY_ALIGNMENT, m.nrows * sizeof(double) );
+    double* y_bound = (double*) allocate( ARRAY_ALIGNMENT, m.nrows * sizeof(double) );
+
+    for(int i = 0; i < m.ncols; i++) {
+        x[i] = 1.0 + (i % 7) * 0.125;
+    }
+
+    // Reference result and a bound for its rounding error
+    run_scalar(&m, x, y_ref);
+    for(int i = 0; i < m.nrows; i++) {
+        y_bound[i] = 0.0;
+        for(int j = m.rowptr[i]; j < m.rowptr[i + 1]; j++) {
+            y_bound[i] += ABS(m.val[j] * x[m.col[j]]);
+        }
+    }
+
+    printf("ISA,Matrix,Rows,Cols,Nnz,Chunk (C),Sigma,SELL Fill,Frequency (GHz)\n");
+    printf("%s,%s,%d,%d,%d,%d,%d,%f,%f\n\n", ISA_STRING, matrix_name, m.nrows, m.ncols, m.nnz, C, sigma, (double) m.nnz_sell / m.nnz, freq);
+    printf("%14s,%14s,%14s,%14s,%14s\n", "Kernel", "tot. time", "GFLOP/s", "bytes/nnz", "cy/nnz");
+    freq = freq * 1e9;
+
+    const char* kernel_names[NKERNELS] = {"scalar", "csr", "sell"};
+    spmv_kernel_t kernels[NKERNELS] = {run_scalar, run_csr, run_sell};
+
+    // Minimum traffic: matrix data, row or chunk pointers, y and x once
+    const double csr_bytes = 12.0 * m.nnz + 4.0 * (m.nrows + 1) + 8.0 * m.nrows + 8.0 * m.ncols;
+    const double sell_bytes = 12.0 * m.nnz_sell + 4.0 * (m.nchunks + 1) + 8.0 * m.nchunks * C + 8.0 * m.ncols;
+    const double kernel_bytes[NKERNELS] = {csr_bytes, csr_bytes, sell_bytes};
+
+    for(int k = 0; k < NKERNELS; k++) {
+        int rep;
+
+        for(int i = 0; i < m.nrows; i++) {
+            y[i] = 0.0;
+        }
+
+        double time = measure_spmv(kernels[k], &m, x, y, &rep);
+        if(kernels[k] == run_sell) {
+            sell_result(&m, y);
+        }
+
+        for(int i = 0; i < m.nrows; i++) {
+            if(ABS(y[i] - y_ref[i]) > 1e-12 * y_bound[i] * (m.rowptr[i + 1] - m.rowptr[i] + 1)) {
+                printf("Verification failed for %s kernel in row %d: %f != %f\n", kernel_names[k], i, y[i], y_ref[i]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        const double gflops = 2.0 * m.nnz * rep / time * 1e-9;
+        const double bytes_per_nnz = kernel_bytes[k] / m.nnz;
+        const double cy_per_nnz = time * freq / ((double) m.nnz * rep);
+        printf("%14s,%14.10f,%14.6f,%14.6f,%14.6f\n", kernel_names[k], time, gflops, bytes_per_nnz, cy_per_nnz);
+    }
+
+    free(x);
+    free(y);
+    free(y_ref);
+    free(y_bound);
+    free(m.rowptr);
+    free(m.col);
+    free(m.val);
+    free(m.perm);
+    free(m.chunkptr);
+    free(m.sell_col);
+    free(m.sell_val);
+    free(m.y_sell);
+
+    LIKWID_MARKER_CLOSE;
+    return EXIT_SUCCESS;
+}
@@ -34,6 +34,9 @@
 //---
 #include <timing.h>
 #include <allocate.h>
+#include <cache_state.h>
+#include <gatherbench.h>
+#include <interference.h>
 
 #if !defined(ISA_avx2) && !defined (ISA_avx512) && !defined(ISA_sve)
 #error "Invalid ISA macro, possible values are: avx2, avx512 and sve"
@@ -53,6 +56,12 @@
 
 #define ARRAY_ALIGNMENT  64
 #define SIZE  20000
+#define TABLE_LOOKUPS  4096
+#define MAX_TABLE  128
+#define ILP_CHAINS  5
+#define CHASE_MAX_LANES  64
+#define MAX_ARRAYS  8
+#define MULTI_COUNTS  4
 
 #if defined(ISA_avx512)
 #define _VL_  8
@@ -71,99 +80,433 @@ extern void gather(double*, int*, int, double*);
 extern void gather(double*, int*, int);
 #endif
 
+#if defined(PERMUTE) || defined(ILP_SWEEP)
+typedef void (*lookup_t)(double*, int*, int, double*, int);
+#endif
+
+#ifdef PERMUTE
+// Looks up table entries with register permutes, falls back to gather for
+// tables larger than the ISA supports
+extern void gather_permute(double*, int*, int, double*, int);
+
+static void gather_table(double* a, int* idx, int N, double* t, int table) {
+#ifdef TEST
+    gather(a, idx, N, t);
+#else
+    gather(a, idx, N);
+#endif
+}
+#endif
+
+#ifdef ILP_SWEEP
+// Gather kernels with 1, 2, 4, 8 and 16 independent gathers per iteration
+extern lookup_t gather_ilp_chains[ILP_CHAINS];
+static const int ilp_chains[ILP_CHAINS] = {1, 2, 4, 8, 16};
+#endif
+
+#if defined(PERMUTE) || defined(ILP_SWEEP)
+typedef struct {
+    lookup_t kernel;
+    double* a;
+    int* idx;
+    int N;
+    double* t;
+    int table;
+} lookup_run_t;
+
+static void run_lookups(void* arg) {
+    lookup_run_t* run = arg;
+    run->kernel(run->a, run->idx, run->N, run->t, run->table);
+}
+
+static double measure_lookups(lookup_t kernel, double* a, int* idx, int N, double* t, int table, int* rep) {
+    lookup_run_t run = {kernel, a, idx, N, t, table};
+
+    return measureReps(run_lookups, &run, "gather", rep);
+}
+#endif
+
+#ifdef MULTI_ARRAY
+// Gathers from K = 1..MAX_ARRAYS arrays with one index vector, indexed by
+// K - 1. Array k holds doubles, floats or ints for k % 3 == 0, 1 or 2.
+typedef void (*gather_multi_t)(void**, int*, int, double*);
+typedef void (*gather_pass_t)(void*, int*, int, double*);
+extern gather_multi_t gather_multi_arrays[MAX_ARRAYS];
+extern void gather_pass_f64(void*, int*, int, double*);
+extern void gather_pass_f32(void*, int*, int, double*);
+extern void gather_pass_i32(void*, int*, int, double*);
+static const gather_pass_t gather_pass[3] = {gather_pass_f64, gather_pass_f32, gather_pass_i32};
+static const size_t multi_esize[3] = {sizeof(double), sizeof(float), sizeof(int)};
+static const int multi_counts[MULTI_COUNTS] = {1, 2, 4, 8};
+
+// One pass over K arrays, sharing the loaded index vector or as K separate
+// single array passes
+static void multi_pass(int K, int separate, void** arrays, int* idx, int N, double* t) {
+    if(!separate) {
+        gather_multi_arrays[K - 1](arrays, idx, N, t);
+        return;
+    }
+
+    for(int k = 0; k < K; ++k) {
+        gather_pass[k % 3](arrays[k], idx, N, (t != NULL) ? &t[(long) k * N] : NULL);
+    }
+}
+
+typedef struct {
+    int K;
+    int separate;
+    void** arrays;
+    int* idx;
+    int N;
+    double* t;
+} multi_run_t;
+
+static void run_multi(void* arg) {
+    multi_run_t* run = arg;
+    multi_pass(run->K, run->separate, run->arrays, run->idx, run->N, run->t);
+}
+
+static double measure_multi(int K, int separate, void** arrays, int* idx, int N, double* t, int* rep) {
+    multi_run_t run = {K, separate, arrays, idx, N, t};
+
+    return measureReps(run_multi, &run, "gather", rep);
+}
+#endif
+
+#ifdef LATENCY
+// Dependent gathers through next[], returns the number of lanes
+extern int gather_chase(int* next, int* lanes, int steps);
+// Same with next[] stored as doubles (vgatherdpd and conversion back to int)
+extern int gather_chase_pd(double* next, int* lanes, int steps);
+
+// Single random cycle through all N elements (Sattolo's algorithm)
+static void init_chase(int* next, int N) {
+    srand48(N);
+    for(int i = 0; i < N; ++i) {
+        next[i] = i;
+    }
+
+    for(int i = N - 1; i > 0; --i) {
+        int j = lrand48() % i;
+        int tmp = next[i];
+        next[i] = next[j];
+        next[j] = tmp;
+    }
+}
+
+typedef struct {
+    void* next;
+    int* lanes;
+    int N;
+} chase_run_t;
+
+static void run_chase(void* arg) {
+    chase_run_t* run = arg;
+    gather_chase(run->next, run->lanes, run->N);
+}
+
+static void run_chase_pd(void* arg) {
+    chase_run_t* run = arg;
+    gather_chase_pd(run->next, run->lanes, run->N);
+}
+
+// Walks the whole cycle once per call, lanes start at evenly spread elements
+static double measure_chase(void (*kernel)(void*), void* next, int* lanes, int N, int* rep) {
+    chase_run_t run = {next, lanes, N};
+
+    for(int l = 0; l < CHASE_MAX_LANES; ++l) {
+        lanes[l] = (int)((long) l * N / CHASE_MAX_LANES);
+    }
+
+    return measureReps(kernel, &run, "gather", rep);
+}
+
+#ifdef TEST
+// Lanes after a walk of N / 2 steps from l * (N / CHASE_MAX_LANES), compared
+// against a scalar walk
+static int check_chase(int* next, int* lanes, int nlanes, int N) {
+    for(int l = 0; l < nlanes; ++l) {
+        int j = l * (N / CHASE_MAX_LANES);
+        for(int s = 0; s < N / 2; ++s) {
+            j = next[j];
+        }
+
+        if(lanes[l] != j) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void start_chase(int* lanes, int N) {
+    for(int l = 0; l < CHASE_MAX_LANES; ++l) {
+        lanes[l] = l * (N / CHASE_MAX_LANES);
+    }
+}
+#endif
+#endif
+
 int main (int argc, char** argv) {
     LIKWID_MARKER_INIT;
     LIKWID_MARKER_REGISTER("gather");
 
     if (argc < 3) {
         printf("Please provide stride and frequency\n");
-        printf("%s <stride> <freq (GHz)> [cache line size (B)]\n", argv[0]);
+        printf("%s <stride> <freq (GHz)> [cache line size (B)] [max N]\n", argv[0]);
         return -1;
     }
 
     int stride = atoi(argv[1]);
     double freq = atof(argv[2]);
     int cl_size = (argc == 3) ? 64 : atoi(argv[3]);
+    int max_N = (argc > 4) ? atoi(argv[4]) : INT_MAX;
     size_t bytesPerWord = sizeof(double);
     size_t cacheLinesPerGather = MIN(MAX(stride * _VL_ / (cl_size / sizeof(double)), 1), _VL_);
     size_t N = SIZE;
-    double E, S;
 
-    printf("ISA,Stride (elems),Frequency (GHz),Cache Line Size (B),Vector Width (elems),Cache Lines/Gather\n");
-    printf("%s,%d,%f,%d,%d,%lu\n\n", ISA_STRING, stride, freq, cl_size, _VL_, cacheLinesPerGather);
-    printf("%14s,%14s,%14s,%14s,%14s,%14s\n", "N", "Size(kB)", "tot. time", "time/LUP(ms)", "cy/gather", "cy/elem");
+    printf("ISA,Stride (elems),Frequency (GHz),Cache Line Size (B),Vector Width (elems),Cache Lines/Gather,Cache State\n");
+    printf("%s,%d,%f,%d,%d,%lu,%s\n\n", ISA_STRING, stride, freq, cl_size, _VL_, cacheLinesPerGather, CACHE_STATE_STRING);
+
+#ifdef INTERFERENCE
+    printf("Background Threads,Background Kernel,SMT Gather\n");
+    printf("%d,%s,%s\n\n", BG_THREADS, BG_KERNEL_STRING, BG_SMT_STRING);
+    interference_init();
+#endif
 
     freq = freq * 1e9;
-    for(int N = 1024; N < 400000; N = 1.5 * N) {
-        int N_alloc = N * 2;
-        double* a = (double*) allocate( ARRAY_ALIGNMENT, N_alloc * sizeof(double) );
-        int* idx = (int*) allocate( ARRAY_ALIGNMENT, N_alloc * sizeof(int) );
-        int rep;
-        double time;
+
+#ifdef PERMUTE
+    {
+        // Small tables: a fixed stream of lookups into a table of N entries
+        const char* kernel_names[] = {"gather", "permute"};
+        lookup_t kernels[] = {gather_table, gather_permute};
+        double* a = (double*) allocate( ARRAY_ALIGNMENT, MAX_TABLE * sizeof(double) );
+        int* idx = (int*) allocate( ARRAY_ALIGNMENT, TABLE_LOOKUPS * sizeof(int) );
+        double* t = (double*) allocate( ARRAY_ALIGNMENT, TABLE_LOOKUPS * sizeof(double) );
+
+        printf("%14s,%14s,%14s,%14s\n", "Table(elems)", "Lookups", "cy/elem(gath)", "cy/elem(perm)");
+        for(int N = 8; N <= MAX_TABLE; N += 8) {
+            double cy_per_elem[2];
+
+            for(int i = 0; i < N; ++i) {
+                a[i] = i;
+            }
+
+            for(int i = 0; i < TABLE_LOOKUPS; ++i) {
+                idx[i] = (int)(((long) i * stride) % N);
+            }
+
+            for(int k = 0; k < 2; ++k) {
+                int rep;
+                double time = measure_lookups(kernels[k], a, idx, TABLE_LOOKUPS, t, N, &rep);
+                cy_per_elem[k] = time * freq / ((double) TABLE_LOOKUPS * rep);
 
 #ifdef TEST
-        double* t = (double*) allocate( ARRAY_ALIGNMENT, N_alloc * sizeof(double) );
+                for(int i = 0; i < TABLE_LOOKUPS; ++i) {
+                    if(t[i] != idx[i]) {
+                        printf("Test failed for %s kernel!\n", kernel_names[k]);
+                        return EXIT_FAILURE;
+                    }
+                }
+#endif
+            }
+
+            printf("%14d,%14d,%14.6f,%14.6f\n", N, TABLE_LOOKUPS, cy_per_elem[0], cy_per_elem[1]);
+        }
+
+#ifdef TEST
+        printf("Test passed!\n");
+#endif
+        printf("\n");
+        free(a);
+        free(idx);
+        free(t);
+    }
+#endif
+
+    printf("%14s,%14s,%14s,%14s,%14s,%14s", "N", "Size(kB)", "tot. time", "time/LUP(ms)", "cy/gather", "cy/elem");
+    printf(",%14s,%14s,%14s,%14s,%14s", "CLs touched", "pages touched", "useful GB/s", "xfer GB/s", "CL util");
+#ifdef CACHE_COLD
+    printf(",%14s,%14s,%14s", "cy/elem(c,min)", "cy/elem(c,med)", "cy/elem(c,max)");
+#endif
+#ifdef INTERFERENCE
+    printf(",%14s,%14s", "cy/elem(intf)", "BG GB/s");
+#endif
+#ifdef ILP_SWEEP
+    for(int k = 0; k < ILP_CHAINS; ++k) {
+        char tmp_str[32];
+        snprintf(tmp_str, sizeof tmp_str, "cy/elem(%d)", ilp_chains[k]);
+        printf(",%14s", tmp_str);
+    }
+#endif
+#ifdef MULTI_ARRAY
+    for(int k = 0; k < MULTI_COUNTS; ++k) {
+        char tmp_str[32];
+        snprintf(tmp_str, sizeof tmp_str, "cy/elem(K%d)", multi_counts[k]);
+        printf(",%14s", tmp_str);
+        snprintf(tmp_str, sizeof tmp_str, "cy/elem(K%d,sep)", multi_counts[k]);
+        printf(",%14s", tmp_str);
+    }
+#endif
+#ifdef LATENCY
+    printf(",%14s,%17s", "cy/gather(lat)", "cy/gather(lat,pd)");
+#endif
+    printf("\n");
+    for(int N = 1024; N < 400000 && N <= max_N; N = 1.5 * N) {
+        gatherbench_t bench = { .kernel = GB_KERNEL_GATHER, .index = GB_INDEX_STRIDE, .N = N, .stride = stride, .cl_size = cl_size, .freq = freq / 1e9 };
+        gatherbench_result_t res;
+
+#ifdef CACHE_COLD
+        bench.cold = 1;
 #endif
 
-        for(int i = 0; i < N_alloc; ++i) {
-            a[i] = i;
-            idx[i] = (int)(((long) i * stride) % N);
+        if(!gatherbench_init(&bench) || !gatherbench_run(&bench, &res)) {
+            return EXIT_FAILURE;
         }
 
-        S = getTimeStamp();
-        for(int r = 0; r < 100; ++r) {
 #ifdef TEST
-            gather(a, idx, N, t);
+        if(!res.test) {
+            printf("Test failed!\n");
+            return EXIT_FAILURE;
+        } else {
+            printf("Test passed!\n");
+        }
+#endif
+
+        const double size = N * (sizeof(double) + sizeof(int)) / 1000.0;
+        printf("%14d,%14.2f,%14.10f,%14.10f,%14.6f,%14.6f", N, size, res.time, res.time_per_lup, res.cy_per_gather, res.cy_per_elem);
+        printf(",%14ld,%14ld,%14.2f,%14.2f,%14.4f", bench.lines, bench.pages, res.useful_gbs, res.transferred_gbs, res.line_utilization);
+
+#ifdef CACHE_COLD
+        printf(",%14.6f,%14.6f,%14.6f", res.cold_min, res.cold_med, res.cold_max);
+#endif
+
+#ifdef INTERFERENCE
+        // Same number of reps as the undisturbed run, with background load
+        interference_start(bench.a, bench.idx, N);
+        const double time_intf = gatherbench_time(&bench, res.reps);
+        const double bg_bw = interference_stop();
+        printf(",%14.6f,%14.2f", time_intf * freq / ((double) N * res.reps), bg_bw);
+#endif
+
+#ifdef ILP_SWEEP
+        // The kernels have no remainder loop, all of them gather the same
+        // multiple of the widest iteration
+        const int N_ilp = N - N % (_VL_ * ilp_chains[ILP_CHAINS - 1]);
+#ifdef TEST
+        double* t_ilp = bench.t;
 #else
-            gather(a, idx, N);
+        double* t_ilp = NULL;
+#endif
+        for(int k = 0; k < ILP_CHAINS; ++k) {
+            int rep_ilp;
+            double time_ilp = measure_lookups(gather_ilp_chains[k], bench.a, bench.idx, N_ilp, t_ilp, N, &rep_ilp);
+            printf(",%14.6f", time_ilp * freq / ((double) N_ilp * rep_ilp));
+
+#ifdef TEST
+            for(int i = 0; i < N_ilp; ++i) {
+                if(bench.t[i] != i * stride % N) {
+                    printf("\nTest failed for %d independent gathers!\n", ilp_chains[k]);
+                    return EXIT_FAILURE;
+                }
+            }
 #endif
         }
-        E = getTimeStamp();
+#endif
 
-        rep = 100 * (0.5 / (E - S));
-        S = getTimeStamp();
-        LIKWID_MARKER_START("gather");
-        for(int r = 0; r < rep; ++r) {
+#ifdef MULTI_ARRAY
+        // Separately allocated arrays, array k starts k elements past a
+        // cache line boundary. The kernels have no remainder loop.
+        const int N_m = N - N % _VL_;
+        void* buffers[MAX_ARRAYS];
+        void* arrays[MAX_ARRAYS];
 #ifdef TEST
-            gather(a, idx, N, t);
+        double* t_multi = (double*) allocate( ARRAY_ALIGNMENT, (size_t) MAX_ARRAYS * N_m * sizeof(double) );
 #else
-            gather(a, idx, N);
+        double* t_multi = NULL;
 #endif
+
+        for(int k = 0; k < MAX_ARRAYS; ++k) {
+            buffers[k] = allocate( ARRAY_ALIGNMENT, (N + MAX_ARRAYS) * multi_esize[k % 3] );
+            arrays[k] = (char*) buffers[k] + k * multi_esize[k % 3];
+            for(int i = 0; i < N; ++i) {
+                const int v = k * N + i;
+                switch(k % 3) {
+                    case 0: ((double*) arrays[k])[i] = v; break;
+                    case 1: ((float*) arrays[k])[i] = v; break;
+                    default: ((int*) arrays[k])[i] = v; break;
+                }
+            }
         }
-        LIKWID_MARKER_STOP("gather");
-        E = getTimeStamp();
 
-        time = E - S;
+        for(int c = 0; c < MULTI_COUNTS; ++c) {
+            const int K = multi_counts[c];
+            for(int separate = 0; separate < 2; ++separate) {
+                int rep_multi;
+                double time_multi = measure_multi(K, separate, arrays, bench.idx, N_m, t_multi, &rep_multi);
+                printf(",%14.6f", time_multi * freq / ((double) N_m * K * rep_multi));
 
 #ifdef TEST
-        int test_failed = 0;
-        for(int i = 0; i < N; ++i) {
-            if(t[i] != i * stride % N) {
-                test_failed = 1;
-                break;
+                for(int k = 0; k < K; ++k) {
+                    for(int i = 0; i < N_m; ++i) {
+                        if(t_multi[(long) k * N_m + i] != k * N + bench.idx[i]) {
+                            printf("\nTest failed for %d arrays%s!\n", K, separate ? " in separate passes" : "");
+                            return EXIT_FAILURE;
+                        }
+                    }
+                }
+#endif
             }
         }
 
-        if(test_failed) {
-            printf("Test failed!\n");
-            return EXIT_FAILURE;
-        } else {
-            printf("Test passed!\n");
+        for(int k = 0; k < MAX_ARRAYS; ++k) {
+            free(buffers[k]);
         }
+        free(t_multi);
 #endif
 
-        const double size = N * (sizeof(double) + sizeof(int)) / 1000.0;
-        const double time_per_it = time * 1e6 / ((double) N * rep);
-        const double cy_per_gather = time * freq * _VL_ / ((double) N * rep);
-        const double cy_per_elem = time * freq / ((double) N * rep);
-        printf("%14d,%14.2f,%14.10f,%14.10f,%14.6f,%14.6f\n", N, size, time, time_per_it, cy_per_gather, cy_per_elem);
-        free(a);
-        free(idx);
+#ifdef LATENCY
+        int* next = (int*) allocate( ARRAY_ALIGNMENT, N * sizeof(int) );
+        double* next_pd = (double*) allocate( ARRAY_ALIGNMENT, N * sizeof(double) );
+        int* lanes = (int*) allocate( ARRAY_ALIGNMENT, CHASE_MAX_LANES * sizeof(int) );
+        int rep_lat, rep_lat_pd;
+
+        init_chase(next, N);
+        for(int i = 0; i < N; ++i) {
+            next_pd[i] = next[i];
+        }
+
+        double time_lat = measure_chase(run_chase, next, lanes, N, &rep_lat);
+        double time_lat_pd = measure_chase(run_chase_pd, next_pd, lanes, N, &rep_lat_pd);
+        printf(",%14.6f,%17.6f", time_lat * freq / ((double) N * rep_lat), time_lat_pd * freq / ((double) N * rep_lat_pd));
+
 #ifdef TEST
-        free(t);
+        start_chase(lanes, N);
+        int nlanes = gather_chase(next, lanes, N / 2);
+        int passed = check_chase(next, lanes, nlanes, N);
+
+        start_chase(lanes, N);
+        nlanes = gather_chase_pd(next_pd, lanes, N / 2);
+        if(!passed || !check_chase(next, lanes, nlanes, N)) {
+            printf("\nTest failed for dependent gathers!\n");
+            return EXIT_FAILURE;
+        }
+#endif
+
+        free(next);
+        free(next_pd);
+        free(lanes);
 #endif
+
+        printf("\n");
+        gatherbench_free(&bench);
     }
 
+#ifdef INTERFERENCE
+    interference_free();
+#endif
+
     LIKWID_MARKER_CLOSE;
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,263 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+//---
+#include <allocate.h>
+#include <md_generator.h>
+
+#ifndef MIN
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#endif
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+
+#define ARRAY_ALIGNMENT  64
+
+static void grow_atoms(md_generator_t* gen, int nmax) {
+    double* x = (double*) allocate( ARRAY_ALIGNMENT, nmax * 3 * sizeof(double) );
+    int* next = (int*) allocate( ARRAY_ALIGNMENT, nmax * sizeof(int) );
+
+    for(int i = 0; i < (gen->nlocal + gen->nghost) * 3; i++) {
+        x[i] = gen->x[i];
+    }
+
+    free(gen->x);
+    free(gen->next);
+    gen->x = x;
+    gen->next = next;
+    gen->nmax = nmax;
+}
+
+static void add_ghost(md_generator_t* gen, int i, double dx, double dy, double dz) {
+    const int g = gen->nlocal + gen->nghost;
+
+    if(g >= gen->nmax) {
+        grow_atoms(gen, gen->nmax * 2);
+    }
+
+    gen->x[g * 3 + 0] = gen->x[i * 3 + 0] + dx;
+    gen->x[g * 3 + 1] = gen->x[i * 3 + 1] + dy;
+    gen->x[g * 3 + 2] = gen->x[i * 3 + 2] + dz;
+    gen->nghost++;
+}
+
+// Periodic images of all local atoms closer than cutoff + skin to a face
+static void setup_ghosts(md_generator_t* gen) {
+    const double cutneigh = gen->cutoff + gen->skin;
+    const double box = gen->box;
+
+    gen->nghost = 0;
+    for(int i = 0; i < gen->nlocal; i++) {
+        int lo[3], hi[3];
+        for(int d = 0; d < 3; d++) {
+            const double xd = gen->x[i * 3 + d];
+            lo[d] = (xd >= box - cutneigh) ? -1 : 0;
+            hi[d] = (xd < cutneigh) ? 1 : 0;
+        }
+
+        for(int sx = lo[0]; sx <= hi[0]; sx++) {
+            for(int sy = lo[1]; sy <= hi[1]; sy++) {
+                for(int sz = lo[2]; sz <= hi[2]; sz++) {
+                    if(sx != 0 || sy != 0 || sz != 0) {
+                        add_ghost(gen, i, sx * box, sy * box, sz * box);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static int coord_to_bin(md_generator_t* gen, double xd) {
+    const double cutneigh = gen->cutoff + gen->skin;
+    const double binsize = (gen->box + 2.0 * cutneigh) / gen->nbins;
+    int b = (int)((xd + cutneigh) / binsize);
+    return (b < 0) ? 0 : ((b >= gen->nbins) ? gen->nbins - 1 : b);
+}
+
+int md_generator_init(md_generator_t* gen) {
+    const double cutneigh = gen->cutoff + gen->skin;
+
+    if(gen->natoms < 1 || gen->density <= 0.0 || gen->cutoff <= 0.0 || gen->skin < 0.0) {
+        fprintf(stderr, "Atoms, density and cutoff must be positive!\n");
+        return 0;
+    }
+
+    srand48(gen->natoms);
+    if(gen->fcc) {
+        // Four atoms per cubic unit cell
+        const int n = MAX((int) round(cbrt(gen->natoms / 4.0)), 1);
+        const double lattice = cbrt(4.0 / gen->density);
+        const double basis[4][3] = {{0.0, 0.0, 0.0}, {0.5, 0.5, 0.0}, {0.5, 0.0, 0.5}, {0.0, 0.5, 0.5}};
+        gen->box = n * lattice;
+        gen->nlocal = 4 * n * n * n;
+        gen->nmax = gen->nlocal * 2;
+        gen->x = (double*) allocate( ARRAY_ALIGNMENT, gen->nmax * 3 * sizeof(double) );
+
+        int i = 0;
+        for(int cx = 0; cx < n; cx++) {
+            for(int cy = 0; cy < n; cy++) {
+                for(int cz = 0; cz < n; cz++) {
+                    for(int b = 0; b < 4; b++) {
+                        gen->x[i * 3 + 0] = (cx + basis[b][0]) * lattice;
+                        gen->x[i * 3 + 1] = (cy + basis[b][1]) * lattice;
+                        gen->x[i * 3 + 2] = (cz + basis[b][2]) * lattice;
+                        i++;
+                    }
+                }
+            }
+        }
+    } else {
+        gen->box = cbrt(gen->natoms / gen->density);
+        gen->nlocal = gen->natoms;
+        gen->nmax = gen->nlocal * 2;
+        gen->x = (double*) allocate( ARRAY_ALIGNMENT, gen->nmax * 3 * sizeof(double) );
+
+        for(int i = 0; i < gen->nlocal * 3; i++) {
+            gen->x[i] = drand48() * gen->box;
+        }
+    }
+
+    if(gen->box <= 2.0 * cutneigh) {
+        fprintf(stderr, "Box length %f must exceed twice the cutoff plus skin, use more atoms!\n", gen->box);
+        return 0;
+    }
+
+    gen->nghost = 0;
+    gen->next = (int*) allocate( ARRAY_ALIGNMENT, gen->nmax * sizeof(int) );
+    gen->nbins = (int)((gen->box + 2.0 * cutneigh) / cutneigh);
+    gen->bins = (int*) allocate( ARRAY_ALIGNMENT, gen->nbins * gen->nbins * gen->nbins * sizeof(int) );
+    gen->maxneighs = 0;
+    gen->nneighs = 0;
+    gen->neighborlists = NULL;
+    gen->numneighs = (int*) allocate( ARRAY_ALIGNMENT, gen->nlocal * sizeof(int) );
+    return 1;
+}
+
+// Random displacement of every local atom, wrapped back into the box
+void md_generator_step(md_generator_t* gen) {
+    if(gen->perturb <= 0.0) {
+        return;
+    }
+
+    for(int i = 0; i < gen->nlocal * 3; i++) {
+        double xd = gen->x[i] + (2.0 * drand48() - 1.0) * gen->perturb;
+        if(xd < 0.0) { xd += gen->box; }
+        if(xd >= gen->box) { xd -= gen->box; }
+        gen->x[i] = xd;
+    }
+}
+
+void md_generator_build(md_generator_t* gen) {
+    const double cutneigh = gen->cutoff + gen->skin;
+    const double cutneighsq = cutneigh * cutneigh;
+    const int nbins = gen->nbins;
+
+    setup_ghosts(gen);
+    const int nall = gen->nlocal + gen->nghost;
+
+    for(int b = 0; b < nbins * nbins * nbins; b++) {
+        gen->bins[b] = -1;
+    }
+
+    for(int i = nall - 1; i >= 0; i--) {
+        const int bx = coord_to_bin(gen, gen->x[i * 3 + 0]);
+        const int by = coord_to_bin(gen, gen->x[i * 3 + 1]);
+        const int bz = coord_to_bin(gen, gen->x[i * 3 + 2]);
+        const int b = (bx * nbins + by) * nbins + bz;
+        gen->next[i] = gen->bins[b];
+        gen->bins[b] = i;
+    }
+
+    if(gen->maxneighs == 0) {
+        // Expected neighbors in the cutoff sphere plus some slack
+        gen->maxneighs = (int)(4.0 / 3.0 * M_PI * cutneighsq * cutneigh * gen->density * 1.5) + 8;
+        gen->neighborlists = (int*) allocate( ARRAY_ALIGNMENT, (long) gen->nlocal * gen->maxneighs * sizeof(int) );
+    }
+
+    int resize = 1;
+    while(resize) {
+        int max_found = 0;
+        resize = 0;
+        gen->nneighs = 0;
+
+        for(int i = 0; i < gen->nlocal; i++) {
+            const double xi = gen->x[i * 3 + 0];
+            const double yi = gen->x[i * 3 + 1];
+            const double zi = gen->x[i * 3 + 2];
+            const int bx = coord_to_bin(gen, xi);
+            const int by = coord_to_bin(gen, yi);
+            const int bz = coord_to_bin(gen, zi);
+            int* neighbors = &gen->neighborlists[(long) i * gen->maxneighs];
+            int n = 0;
+
+            for(int nx = MAX(bx - 1, 0); nx <= MIN(bx + 1, nbins - 1); nx++) {
+                for(int ny = MAX(by - 1, 0); ny <= MIN(by + 1, nbins - 1); ny++) {
+                    for(int nz = MAX(bz - 1, 0); nz <= MIN(bz + 1, nbins - 1); nz++) {
+                        for(int j = gen->bins[(nx * nbins + ny) * nbins + nz]; j >= 0; j = gen->next[j]) {
+                            if(j == i || (gen->half && j < i)) {
+                                continue;
+                            }
+
+                            const double dx = xi - gen->x[j * 3 + 0];
+                            const double dy = yi - gen->x[j * 3 + 1];
+                            const double dz = zi - gen->x[j * 3 + 2];
+                            if(dx * dx + dy * dy + dz * dz < cutneighsq) {
+                                if(n < gen->maxneighs) {
+                                    neighbors[n] = j;
+                                }
+
+                                n++;
+                            }
+                        }
+                    }
+                }
+            }
+
+            gen->numneighs[i] = n;
+            gen->nneighs += n;
+            max_found = MAX(max_found, n);
+        }
+
+        if(max_found > gen->maxneighs) {
+            free(gen->neighborlists);
+            gen->maxneighs = max_found + 8;
+            gen->neighborlists = (int*) allocate( ARRAY_ALIGNMENT, (long) gen->nlocal * gen->maxneighs * sizeof(int) );
+            resize = 1;
+        }
+    }
+}
+
+void md_generator_free(md_generator_t* gen) {
+    free(gen->x);
+    free(gen->next);
+    free(gen->bins);
+    free(gen->neighborlists);
+    free(gen->numneighs);
+}
@@ -0,0 +1,218 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+//---
+#include <allocate.h>
+#include <aosoa.h>
+#include <neighbor_order.h>
+
+#ifndef MIN
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#endif
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+
+#define ARRAY_ALIGNMENT  64
+
+static const char* mode_names[] = { "none", "index", "cacheline", "cluster" };
+
+int neighbor_order_parse(const char* name, neighbor_order_mode_t* mode) {
+    for(int m = NEIGHBOR_ORDER_NONE; m <= NEIGHBOR_ORDER_CLUSTER; m++) {
+        if(strcmp(name, mode_names[m]) == 0) {
+            *mode = (neighbor_order_mode_t) m;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+const char* neighbor_order_name(neighbor_order_mode_t mode) {
+    return (mode >= NEIGHBOR_ORDER_NONE && mode <= NEIGHBOR_ORDER_CLUSTER) ? mode_names[mode] : "unknown";
+}
+
+static int compare_int(const void* a, const void* b) {
+    const int x = *(const int*) a;
+    const int y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+static int compare_uint64(const void* a, const void* b) {
+    const uint64_t x = *(const uint64_t*) a;
+    const uint64_t y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+// Cache line holding the first component of atom k
+static uint64_t cache_line(const neighbor_order_t* ord, int k) {
+    size_t off;
+
+    switch(ord->layout) {
+        case GB_LAYOUT_AOS:     off = (size_t) k * ord->width; break;
+        case GB_LAYOUT_AOSOA:   off = AOSOA_IDX((size_t) k, 0, (size_t) ord->block, (size_t) ord->dims); break;
+        default:                off = (size_t) k; break;
+    }
+
+    return off * sizeof(double) / ord->cl_size;
+}
+
+static void reserve(neighbor_order_t* ord, int nlocal, int maxneighs) {
+    const size_t needed = (size_t) nlocal * maxneighs;
+
+    if(needed > ord->capacity) {
+        free(ord->neighborlists);
+        ord->neighborlists = (int*) allocate( ARRAY_ALIGNMENT, needed * sizeof(int) );
+        ord->capacity = needed;
+    }
+
+    if(nlocal > ord->nlocal_alloc) {
+        free(ord->numneighs);
+        ord->numneighs = (int*) allocate( ARRAY_ALIGNMENT, nlocal * sizeof(int) );
+        ord->nlocal_alloc = nlocal;
+    }
+
+    ord->maxneighs = maxneighs;
+}
+
+static void order_lists(neighbor_order_t* ord, int nlocal, int maxneighs, const int* neighborlists, const int* numneighs) {
+    uint64_t* keys = (uint64_t*) malloc(MAX(maxneighs, 1) * sizeof(uint64_t));
+
+    reserve(ord, nlocal, maxneighs);
+    for(int i = 0; i < nlocal; i++) {
+        const int* in = &neighborlists[i * maxneighs];
+        int* out = &ord->neighborlists[i * maxneighs];
+        const int n = numneighs[i];
+
+        if(ord->mode == NEIGHBOR_ORDER_INDEX) {
+            memcpy(out, in, n * sizeof(int));
+            qsort(out, n, sizeof(int), compare_int);
+        } else if(ord->mode == NEIGHBOR_ORDER_CACHELINE) {
+            // Line in the upper and trace position in the lower half keeps
+            // the sort stable
+            for(int j = 0; j < n; j++) {
+                keys[j] = cache_line(ord, in[j]) << 32 | (uint64_t) j;
+            }
+
+            qsort(keys, n, sizeof(uint64_t), compare_uint64);
+            for(int j = 0; j < n; j++) {
+                out[j] = in[keys[j] & 0xffffffff];
+            }
+        } else {
+            memcpy(out, in, n * sizeof(int));
+        }
+
+        ord->numneighs[i] = n;
+    }
+
+    free(keys);
+}
+
+static void cluster_lists(neighbor_order_t* ord, int nlocal, int nall, int maxneighs, const int* neighborlists, const int* numneighs) {
+    const int m = ord->cluster;
+    const int nclusters = (nlocal + m - 1) / m;
+    const int nclusters_all = (nall + m - 1) / m;
+    int* seen = (int*) malloc(nclusters_all * sizeof(int));
+    int* start = (int*) malloc((nclusters + 1) * sizeof(int));
+    size_t cl_capacity = (size_t) nclusters * 16;
+    int* cl_lists = (int*) malloc(cl_capacity * sizeof(int));
+    int new_maxneighs = 1;
+
+    for(int c = 0; c < nclusters_all; c++) {
+        seen[c] = -1;
+    }
+
+    // Distinct j-clusters of each i-cluster, in ascending order
+    start[0] = 0;
+    for(int ci = 0; ci < nclusters; ci++) {
+        int ncl = 0;
+        for(int i = ci * m; i < MIN((ci + 1) * m, nlocal); i++) {
+            for(int j = 0; j < numneighs[i]; j++) {
+                const int cj = neighborlists[i * maxneighs + j] / m;
+                if(seen[cj] != ci) {
+                    seen[cj] = ci;
+                    if((size_t)(start[ci] + ncl) >= cl_capacity) {
+                        cl_capacity *= 2;
+                        cl_lists = (int*) realloc(cl_lists, cl_capacity * sizeof(int));
+                    }
+
+                    cl_lists[start[ci] + ncl++] = cj;
+                }
+            }
+        }
+
+        qsort(&cl_lists[start[ci]], ncl, sizeof(int), compare_int);
+        start[ci + 1] = start[ci] + ncl;
+        new_maxneighs = MAX(new_maxneighs, ncl * m);
+    }
+
+    reserve(ord, nlocal, new_maxneighs);
+    for(int ci = 0; ci < nclusters; ci++) {
+        for(int i = ci * m; i < MIN((ci + 1) * m, nlocal); i++) {
+            int* out = &ord->neighborlists[i * new_maxneighs];
+            int n = 0;
+
+            // The last cluster may be incomplete
+            for(int k = start[ci]; k < start[ci + 1]; k++) {
+                for(int j = cl_lists[k] * m; j < MIN((cl_lists[k] + 1) * m, nall); j++) {
+                    out[n++] = j;
+                }
+            }
+
+            ord->numneighs[i] = n;
+        }
+    }
+
+    free(seen);
+    free(start);
+    free(cl_lists);
+}
+
+void neighbor_order_apply(neighbor_order_t* ord, int nlocal, int nall, int maxneighs, const int* neighborlists, const int* numneighs) {
+    if(ord->mode == NEIGHBOR_ORDER_CLUSTER) {
+        cluster_lists(ord, nlocal, nall, maxneighs, neighborlists, numneighs);
+    } else {
+        order_lists(ord, nlocal, maxneighs, neighborlists, numneighs);
+    }
+
+    ord->nneighs = 0;
+    for(int i = 0; i < nlocal; i++) {
+        ord->nneighs += ord->numneighs[i];
+    }
+}
+
+void neighbor_order_free(neighbor_order_t* ord) {
+    free(ord->neighborlists);
+    free(ord->numneighs);
+    ord->neighborlists = NULL;
+    ord->numneighs = NULL;
+    ord->capacity = 0;
+    ord->nlocal_alloc = 0;
+}
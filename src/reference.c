@@ -0,0 +1,66 @@
+/*
+ * =======================================================================================
+ *
+ *      Author:   Jan Eitzinger (je), jan.eitzinger@fau.de
+ *      Copyright (c) 2020 RRZE, University Erlangen-Nuremberg
+ *
+ *      Permission is hereby granted, free of charge, to any person obtaining a copy
+ *      of this software and associated documentation files (the "Software"), to deal
+ *      in the Software without restriction, including without limitation the rights
+ *      to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *      copies of the Software, and to permit persons to whom the Software is
+ *      furnished to do so, subject to the following conditions:
+ *
+ *      The above copyright notice and this permission notice shall be included in all
+ *      copies or substantial portions of the Software.
+ *
+ *      THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *      IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *      FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *      AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *      LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *      OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *      SOFTWARE.
+ *
+ * =======================================================================================
+ */
+#include <stddef.h>
+//---
+#include <reference.h>
+
+void spmv_csr_scalar(int nrows, const int* rowptr, const int* col, const double* val, const double* x, double* y) {
+    for(int i = 0; i < nrows; i++) {
+        double sum = 0.0;
+        for(int j = rowptr[i]; j < rowptr[i + 1]; j++) {
+            sum += val[j] * x[col[j]];
+        }
+
+        y[i] = sum;
+    }
+}
+
+void pull_sum_scalar(int nrows, const int* rowptr, const int* col, const double* x, double* y) {
+    for(int i = 0; i < nrows; i++) {
+        double sum = 0.0;
+        for(int j = rowptr[i]; j < rowptr[i + 1]; j++) {
+            sum += x[col[j]];
+        }
+
+        y[i] = sum;
+    }
+}
+
+void embedding_scalar(const float* table, int D, const int* idx, int nbags, int bag, float* out) {
+    for(int b = 0; b < nbags; b++) {
+        for(int c = 0; c < D; c++) {
+            out[(size_t) b * D + c] = 0.0f;
+        }
+
+        for(int j = 0; j < bag; j++) {
+            const float* row = &table[(size_t) idx[(size_t) b * bag + j] * D];
+            for(int c = 0; c < D; c++) {
+                out[(size_t) b * D + c] += row[c];
+            }
+        }
+    }
+}
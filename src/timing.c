@@ -26,6 +26,10 @@
  */
 #include <stdlib.h>
 #include <time.h>
+//---
+#include <likwid-marker.h>
+//---
+#include <timing.h>
 
 double getTimeStamp()
 {
@@ -45,3 +49,30 @@ double getTimeStamp_()
 {
     return getTimeStamp();
 }
+
+double measureReps(void (*kernel)(void*), void* arg, const char* region, int* rep)
+{
+    double E, S;
+    (void) region;
+
+    S = getTimeStamp();
+    for(int r = 0; r < 10; ++r) {
+        kernel(arg);
+    }
+    E = getTimeStamp();
+
+    *rep = 10 * (0.5 / (E - S));
+    if(*rep < 1) {
+        *rep = 1;
+    }
+
+    S = getTimeStamp();
+    LIKWID_MARKER_START(region);
+    for(int r = 0; r < *rep; ++r) {
+        kernel(arg);
+    }
+    LIKWID_MARKER_STOP(region);
+    E = getTimeStamp();
+
+    return E - S;
+}